@@ -1,7 +1,13 @@
 #ifndef PRIVATE_GREATER_THAN_GREATER_THAN_HPP
 #define PRIVATE_GREATER_THAN_GREATER_THAN_HPP
 #include <NTL/ZZX.h>
+#include <cstdint>
+#include "SymRLWE/types.hpp"
 #include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 /// Arguments for private greater than.
 /// Return mu0 if greater, otherwise return mu1
 struct GreaterThanArgs {
@@ -22,6 +28,7 @@ class FHEcontext; // From HElib
 class FHESecKey; // From HElib
 class FHEPubKey; // From HElib
 class Ctxt; // From HElib
+class DoubleCRT; // From HElib
 /// Create a GreaterThanArgs for the private greater than.
 /// Return (a cipher of) mu0 if the A > B, otherwise return mu1.
 GreaterThanArgs create_greater_than_args(long mu0, long mu1, FHEcontext const& context);
@@ -32,6 +39,25 @@ Ctxt encrypt_in_degree(long value, FHESecKey const& key);
 void encrypt_in_degree(Ctxt &ctx, long val, FHEPubKey const& key);
 void encrypt_in_degree(Ctxt &ctx, long val, FHESecKey const& key);
 
+/// A fresh secret-key encryption (a, b) with a + s * b = p * e + m, of which the uniform b
+/// is not stored but expanded from the seed by sampleUniform() of SymRLWE.
+/// It takes about half of a Ctxt on the wire.
+struct SeededCtxt {
+    NTL::ZZ seed;
+    std::shared_ptr<DoubleCRT> a;
+    double noise_var; // HElib's noise estimate of the fresh ciphertext
+};
+
+/// The noise estimate that HElib gives to a fresh secret-key encryption under the key.
+double fresh_noise_var(FHESecKey const& key);
+
+/// Same as encrypt_in_degree(ctx, val, key), with b expanded from a fresh seed.
+void encrypt_in_degree(SeededCtxt &ctx, long val, FHESecKey const& key, double noise_var);
+
+/// Expand the seed into a Ctxt under the key of ctxt. Return false on a malformed input,
+/// e.g., a not at the ciphertext primes, or a noise_var that is not positive and below the modulus.
+bool expand_seeded(Ctxt &ctxt, SeededCtxt const& seeded);
+
 /// Add the necessary key switching matrix into the key.
 /// This method should be called before calling the private greater than.
 void setup_auxiliary_for_greater_than(FHESecKey *sk);
@@ -47,14 +73,129 @@ Ctxt greater_than(Ctxt const&a, long b, GreaterThanArgs const& args, FHEcontext
 Ctxt greater_than(Ctxt const& ctx_a, Ctxt const& ctx_b, FHEcontext const& context);
 Ctxt greater_than(Ctxt const& ctx_a, long b, FHEcontext const& context);
 
+/// The (mu1 - (mu0 + mu1)/2) * test_v multiplied to E(X^{a - b}) in the comparisons,
+/// encoded once for comparing many pairs of ciphertexts under the same arguments.
+EncodedPlaintext encode_test_v(GreaterThanArgs const& args, FHEcontext const& context);
+
+/// Same as greater_than(ctx_a, ctx_b, args, context), with test_v = encode_test_v(args, context).
+Ctxt greater_than(Ctxt const& ctx_a, Ctxt const& ctx_b, GreaterThanArgs const& args,
+                  EncodedPlaintext const& test_v, FHEcontext const& context);
+
+/// The plaintext multiplied to E(X^a) when comparing it with the plaintext b.
+/// That is (mu1 - (mu0 + mu1)/2) * X^{-b} * test_v mod X^N + 1, where 0 <= b < N.
+NTL::ZZX threshold_poly(long b, GreaterThanArgs const& args, FHEcontext const& context);
+
+/// Cache of the encoded threshold polynomials, keyed by (b, mu0, mu1).
+/// The thresholds of a model never change, so they are encoded once and
+/// the comparisons skip the ZZX construction and the CRT conversion.
+/// get() is thread-safe, and the returned reference lives as long as the cache.
+class ThresholdCache {
+public:
+    explicit ThresholdCache(FHEcontext const& context);
+
+    ~ThresholdCache();
+
+    ThresholdCache(ThresholdCache const& oth) = delete;
+
+    ThresholdCache& operator=(ThresholdCache const& oth) = delete;
+
+    EncodedPlaintext const& get(long b, GreaterThanArgs const& args);
+
+    size_t size() const;
+
+private:
+    using key_t = std::tuple<long, long, long>;
+    FHEcontext const& context_;
+    std::map<key_t, EncodedPlaintext> encoded_;
+    mutable std::mutex mtx_;
+};
+
+/// Same as greater_than(ctx_a, b, args, context), with the threshold polynomial already encoded.
+Ctxt greater_than(Ctxt const& ctx_a, EncodedPlaintext const& threshold,
+                  GreaterThanArgs const& args, FHEcontext const& context);
+
 /// Privately accounting how many values in ctx_b_vec is less than the value encrypted in ctxt_a.
 /// That is to return a ciphertext that encrypts this cardinality |{i| b_i < a}| in its 0-th coefficient.
 Ctxt count_less_than(Ctxt const& ctxt_a, std::vector<Ctxt> const& ctx_b_vec, FHEcontext const& context);
+/// Same as above, with test_v = encode_test_v(create_greater_than_args(1, 0, context), context).
+Ctxt count_less_than(Ctxt const& ctxt_a, std::vector<Ctxt> const& ctx_b_vec,
+                     EncodedPlaintext const& test_v, FHEcontext const& context);
+
+/// Batched comparisons of small-domain values. A domain D (a power of two dividing N)
+/// splits Z[X]/(X^N + 1) into s = N / D lanes, where the j-th coefficient class mod s
+/// is a copy of the subring Z[Y]/(Y^D + 1) with Y = X^s. The value a_j of the j-th lane
+/// is encoded as X^j * Y^{a_j}, so that multiplying by a polynomial in Y compares all
+/// the lanes at once, and the result of the j-th lane is the j-th coefficient.
+/// Return the number of lanes s.
+long batch_lanes(long domain, FHEcontext const& context);
+
+/// Encrypt up to batch_lanes(domain) values in [0, domain), i.e., sum_j X^{j + s * values[j]}.
+/// A single value encrypts Y^b, which is the encrypted threshold of greater_than_batch().
+void encrypt_batch(Ctxt &ctx, std::vector<long> const& values, long domain, FHEPubKey const& key);
+void encrypt_batch(Ctxt &ctx, std::vector<long> const& values, long domain, FHESecKey const& key);
+
+/// The polynomial in Y that compares all the lanes with the plaintext b, 0 <= b < domain.
+/// That is (mu1 - (mu0 + mu1)/2) * Y^{-b} * (1 + Y + ... + Y^{D - 1}) mod Y^D + 1.
+NTL::ZZX batch_threshold_poly(long b, long domain, GreaterThanArgs const& args, FHEcontext const& context);
+
+/// Compare every lane of ctx_a with the same threshold b, using one plaintext multiplication.
+/// The j-th coefficient of the result is mu0 if a_j > b, otherwise mu1.
+Ctxt greater_than_batch(Ctxt const& ctx_a, long b, long domain,
+                        GreaterThanArgs const& args, FHEcontext const& context);
+
+/// Same as above, with the threshold encrypted by encrypt_batch({b}, domain), using one
+/// homomorphic multiplication for all the lanes.
+Ctxt greater_than_batch(Ctxt const& ctx_a, Ctxt const& ctx_b, long domain,
+                        GreaterThanArgs const& args, FHEcontext const& context);
+
+/// Decode the results of the first count lanes, in [0, p^r).
+std::vector<long> decode_batch(NTL::ZZX const& poly, long count, FHEcontext const& context);
+
+/// Comparisons of values wider than the degree, e.g., 32-bit features.
+/// A bits-bit value is split into base-N digits (least significant first), one encrypt_in_degree()
+/// ciphertext per digit. Return the number of digits, or 0 unless 0 < bits <= 64.
+long wide_digits(long bits, FHEcontext const& context);
+
+/// Encrypt the digits of value. Return an empty vector if bits is out of range as above,
+/// or value does not fit in bits bits.
+std::vector<Ctxt> encrypt_wide(uint64_t value, long bits, FHEPubKey const& key);
+std::vector<Ctxt> encrypt_wide(uint64_t value, long bits, FHESecKey const& key);
+
+/// Privately comparing two values encrypted by encrypt_wide(), with the same number of digits.
+/// Each digit gives the bits [a_i > b_i] by greater_than() and [a_i = b_i] by equality_test(),
+/// whose constant terms are isolated by the field trace. They are then combined
+/// lexicographically, so the result encrypts mu0 if a > b, otherwise mu1, as greater_than(),
+/// and nothing about the individual digits. It takes 1 + ceil(log2(digits)) levels of
+/// multiplications and O(log N) key switchings per digit.
+/// Call setup_auxiliary_for_packing() for the field trace as well.
+Ctxt greater_than_wide(std::vector<Ctxt> const& ctx_a, std::vector<Ctxt> const& ctx_b,
+                       GreaterThanArgs const& args, FHEcontext const& context);
+/// Same as above, with the plaintext b. If b does not fit in the digits of a, the result
+/// encrypts mu1, since a > b is false.
+Ctxt greater_than_wide(std::vector<Ctxt> const& ctx_a, uint64_t b,
+                       GreaterThanArgs const& args, FHEcontext const& context);
 
 /// Privately comparing two encrypted values.
 /// Return a cipher of 0 if the two values are equal, otherwise return a cipher of 1.
+/// No plaintext polynomial is multiplied, i.e., the result is 1 - X^{a - b}.
 Ctxt equality_test(Ctxt const& ctx_a, Ctxt const& ctx_b, FHEcontext const& context, bool randomized = true);
 
 /// E(X^a) --> E(X^{-a})
 void smart_negate_degree(Ctxt *ctx, FHEcontext const& context);
+
+/// Add the key switching matrices of the automorphisms X --> X^{2^k + 1} used by pack_constants().
+void setup_auxiliary_for_packing(FHESecKey *sk);
+
+/// Whether the key has the key switching matrices of pack_constants().
+bool can_pack_constants(FHEPubKey const& pk);
+
+/// Pack the constant terms of n ciphertexts into one ciphertext [Chen-Dai-Kim-Song'20].
+/// n = cts.size() should be a power of two and at most N = phi(M). Null entries stand for zeros.
+/// The constant term of cts[i] times N goes to the coefficient i * N / n, and the other
+/// coefficients of the result are zeros. It takes O(log N) key switchings.
+Ctxt pack_constants(std::vector<const Ctxt *> const& cts, FHEPubKey const& pk);
+
+/// Decode the n values packed by pack_constants(), in [0, p^r).
+/// Return an empty vector if n is not a power of two in [1, N].
+std::vector<long> unpack_constants(NTL::ZZX const& poly, long n, FHEcontext const& context);
 #endif // PRIVATE_GREATER_THAN_GREATER_THAN_HPP
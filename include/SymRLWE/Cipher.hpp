@@ -1,45 +1,93 @@
 #ifndef SYM_RLWE_CIPHER_HPP
 #define SYM_RLWE_CIPHER_HPP
 #include "SymRLWE/types.hpp"
-namespace NTL { class ZZX; }
+#include <iosfwd>
+namespace NTL { class ZZX; class ZZ; }
+class FHEcontext;
 class PrivateKey;
+/// A cipher owns its components, i.e., copies never share them.
+/// The components are drawn from the PolynomialPool of the encrypting key, and the copy
+/// assignment overwrites the components of the target in place, so a preallocated
+/// cipher can be reused as the output of a loop.
 class Cipher {
 public:
     Cipher();
    
     Cipher(const Cipher &oth);
 
-    Cipher(Cipher &&oth);
+    Cipher(Cipher &&oth) noexcept;
 
-    Cipher& operator=(Cipher &&oth);
+    Cipher& operator=(const Cipher &oth);
+
+    Cipher& operator=(Cipher &&oth) noexcept;
+
+    void swap(Cipher &oth) noexcept;
 
     Cipher& operator*=(const NTL::ZZX &v);
 
+    /// v should be encoded over all the primes, e.g., by encode_threshold(), as the
+    /// components. Otherwise v is converted again for each component.
+    Cipher& operator*=(const EncodedPlaintext &v);
+
+    /// E(m) --> E(m * v + c), with v converted once for both components.
+    Cipher& mul_add_constant(const NTL::ZZX &v, const long c);
+
+    Cipher& mul_add_constant(const EncodedPlaintext &v, const long c);
+
+    /// Multiply by X^k, i.e., E(m) --> E(m * X^k).
+    Cipher& mul_by_monomial(const long k);
+
     Cipher& operator+=(const long v);
 
     Cipher& operator+=(const Cipher &oth);
 
     Cipher& power(const long k);
 
+    /// Whether the uniform component b is still the expansion of its seed, as a fresh
+    /// cipher from PrivateKey::Encrypt(). Any update of the cipher drops the seed.
+    bool is_seeded() const {
+        return seed != nullptr;
+    }
+
+    /// Binary IO. A seeded cipher is written as the seed of b plus the component a,
+    /// i.e., about half of the size. b is expanded from the seed on the first update.
+    /// Return false without writing anything if the cipher is empty, e.g., moved-from.
+    bool write(std::ostream &os) const;
+
+    /// The components are drawn from pool if given, e.g., PrivateKey::getPool().
+    bool read(std::istream &is, const FHEcontext &context,
+              std::shared_ptr<PolynomialPool> pool = nullptr);
+
     ~Cipher();
     /// PrivateKey instance get access set_cipher method for encryption.
     friend class PrivateKey;
 
 protected:
-    void set_cipher(Polynomial_ptr a, Polynomial_ptr b) {
+    void set_cipher(Polynomial_ptr a, Polynomial_ptr b,
+                    std::shared_ptr<const NTL::ZZ> seed = nullptr) {
         this->a = a;
         this->b = b;
+        this->seed = seed;
     }
 
     Polynomial_ptr get_a() const {
         return a;
     }
 
+    /// Null for a seeded cipher that is not expanded yet.
     Polynomial_ptr get_b() const {
         return b;
     }
+
+    std::shared_ptr<const NTL::ZZ> get_seed() const {
+        return seed;
+    }
 private:
+    /// Expand b if necessary and drop the seed, before updating the cipher.
+    void expand();
+
     Polynomial_ptr a, b;
+    std::shared_ptr<const NTL::ZZ> seed;
 };
 
 #endif // SYM_RLWE_CIPHER_HPP
@@ -1,6 +1,7 @@
 #ifndef SYM_RLWE_GREATER_THAN_HPP
 #define SYM_RLWE_GREATER_THAN_HPP
 #include <NTL/ZZX.h>
+#include "SymRLWE/types.hpp"
 
 struct GreaterThanArgs {
     long mu0;
@@ -25,6 +26,28 @@ Cipher greater_than(const Cipher &a, long b,
                     const GreaterThanArgs& args,
                     const FHEcontext &context);
 
+/// (mu1 - mu0)/2 * X^{-b} * test_v, encoded once for comparing many ciphers with b.
+/// It is encoded over all the primes, as the components of Cipher.
+EncodedPlaintext encode_threshold(long b,
+                                  const GreaterThanArgs& args,
+                                  const FHEcontext &context);
+
+/// Same as greater_than(a, b, args, context) with b = encode_threshold(b, args, context).
+Cipher greater_than(const Cipher &a, const EncodedPlaintext &b,
+                    const GreaterThanArgs& args,
+                    const FHEcontext &context);
+
+/// Same as greater_than(), but written into out, whose components are reused if any.
+/// out should not be a.
+void greater_than_into(Cipher &out, const Cipher &a, long b,
+                       const GreaterThanArgs& args,
+                       const FHEcontext &context);
+
+/// b from encode_threshold() is over the primes of the components, so it is not converted again.
+void greater_than_into(Cipher &out, const Cipher &a, const EncodedPlaintext &b,
+                       const GreaterThanArgs& args,
+                       const FHEcontext &context);
+
 /// Use for debugging, same logic with the method above.
 NTL::ZZX greater_than(const NTL::ZZX &poly_a, long b, 
                       const GreaterThanArgs& args,
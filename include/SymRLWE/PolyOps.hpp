@@ -0,0 +1,13 @@
+#ifndef SYM_RLWE_POLY_OPS_HPP
+#define SYM_RLWE_POLY_OPS_HPP
+namespace NTL { class ZZX; }
+/// Structured products in Z[X]/(X^n + 1) that avoid a generic MulMod.
+
+/// out = a * (1 + X + ... + X^{n-1}) mod X^n + 1, in O(n).
+/// The k-th coefficient is sum_{i <= k} a_i - sum_{i > k} a_i. Requires deg(a) < n.
+void mul_by_test_v(NTL::ZZX *out, const NTL::ZZX &a, long n);
+
+/// out = a * X^k mod X^n + 1, in O(n), i.e., a negacyclic rotation of the coefficients.
+/// k can be negative. Requires deg(a) < n.
+void mul_by_monomial(NTL::ZZX *out, const NTL::ZZX &a, long k, long n);
+#endif // SYM_RLWE_POLY_OPS_HPP
@@ -6,6 +6,8 @@ class FHEcontext;
 class Cipher;
 namespace NTL { class ZZX; }
 void encodeOnDegree(NTL::ZZX *poly, long degree, const FHEcontext &context);
+/// The uniform polynomial derived from the seed, the same on every machine.
+void sampleUniform(Polynomial *poly, const NTL::ZZ &seed);
 
 class PrivateKey {
 public:
@@ -18,6 +20,9 @@ public:
     ~PrivateKey();
 
     const FHEcontext& getContext() const;
+
+    /// The pool of the ciphers encrypted under the key, shared by the copies of the key.
+    std::shared_ptr<PolynomialPool> getPool() const;
     /// Lift the s(X) to s^k(X).
     void power(long k);
 
@@ -31,6 +36,7 @@ private:
     const FHEcontext &context;
     NTL::ZZ ptxtSpace;
     Polynomial_ptr private_s;
+    std::shared_ptr<PolynomialPool> pool;
 };
 
 #endif // SYM_RLWE_PRIVATE_KEY_HPP
@@ -1,8 +1,94 @@
 #ifndef SYM_RLWE_TYPES_HPP
 #define SYM_RLWE_TYPES_HPP
 #include <memory>
+#include <mutex>
+#include <vector>
 class DoubleCRT;
+class FHEcontext;
+class IndexSet;
+namespace NTL { class ZZX; }
 typedef DoubleCRT Polynomial;
 typedef std::shared_ptr<Polynomial> Polynomial_ptr;
+/// A copy of a, drawn from the pool of a if it came from one that is still alive, see PolynomialPool.
 Polynomial_ptr copy_ptr(const Polynomial_ptr a);
+
+/// A polynomial over all the primes of the context of a, whose value is unspecified.
+/// Drawn from the pool of a as copy_ptr().
+Polynomial_ptr new_ptr(const Polynomial_ptr a);
+
+/// Pool of the polynomials over all the primes of one context, i.e., DoubleCRT(context).
+/// Each of them holds a residue table per prime, so every Cipher used to cost two large
+/// allocations. The polynomials from acquire() go back to the pool when their last
+/// Polynomial_ptr is gone, and keep their tables for the next acquire().
+/// A pool is owned through shared_ptr, e.g., by the PrivateKey that creates it, and the
+/// polynomials only refer to it weakly: those released after the pool is gone are freed.
+/// Thread-safe.
+class PolynomialPool : public std::enable_shared_from_this<PolynomialPool> {
+public:
+    static std::shared_ptr<PolynomialPool> create(const FHEcontext &context);
+
+    /// The pool that poly is acquired from, nullptr if there is none or it is gone.
+    static std::shared_ptr<PolynomialPool> owner(const Polynomial_ptr &poly);
+
+    PolynomialPool(PolynomialPool const& oth) = delete;
+
+    PolynomialPool& operator=(PolynomialPool const& oth) = delete;
+
+    ~PolynomialPool();
+
+    /// A polynomial over all the primes, whose value is unspecified.
+    Polynomial_ptr acquire();
+
+    /// A copy of poly.
+    Polynomial_ptr acquire(const Polynomial &poly);
+
+    /// Keep at most capacity idle polynomials, the others are freed when released.
+    void set_capacity(size_t capacity);
+
+    size_t idle() const;
+
+private:
+    explicit PolynomialPool(const FHEcontext &context);
+
+    /// Return the polynomial to its pool if the pool is still alive, or free it.
+    struct Deleter {
+        std::weak_ptr<PolynomialPool> pool;
+        void operator()(Polynomial *poly) const;
+    };
+
+    void release(Polynomial *poly);
+
+    std::unique_ptr<Polynomial> prototype_; // zero over all the primes
+    std::vector<std::unique_ptr<Polynomial>> idle_;
+    size_t capacity_;
+    mutable std::mutex mtx_;
+};
+
+/// A plaintext polynomial converted into DoubleCRT form once.
+/// Multiplying it to a ciphertext (Cipher or HElib's Ctxt) is then a pointwise product,
+/// without converting the same polynomial again for every ciphertext component.
+/// Copies share the encoded polynomial.
+class EncodedPlaintext {
+public:
+    EncodedPlaintext() {}
+
+    /// Encode over all the ciphertext primes of the context, as HElib's Ctxt parts.
+    EncodedPlaintext(const NTL::ZZX &poly, const FHEcontext &context);
+
+    /// Encode over the given primes. A product with a polynomial over other primes
+    /// converts the plaintext again, so use the primes of the ciphertext, e.g.,
+    /// context.allPrimes() for Cipher.
+    EncodedPlaintext(const NTL::ZZX &poly, const FHEcontext &context, const IndexSet &primes);
+
+    bool empty() const {
+        return !poly_;
+    }
+
+    const Polynomial& poly() const {
+        return *poly_;
+    }
+
+private:
+    std::shared_ptr<const Polynomial> poly_;
+};
 #endif //SYM_RLWE_TYPES_HPP
@@ -3,6 +3,7 @@
 #include <boost/asio/ip/tcp.hpp>
 #include "network/net_io.hpp"
 #include <string>
+#include <vector>
 #include <memory>
 using boost::asio::ip::tcp;
 
@@ -12,12 +13,36 @@ public:
 
     ~PPDTServer() {}
 
+    /// Load a model in the text format (samples/*.result) or the compiled format.
     bool load(std::string const& file);
 
+    /// Load a forest of trees over the same features. Each session evaluates
+    /// all the trees and the client gets one result per tree.
+    /// On failure, the previously loaded model is kept. On success, the cached
+    /// client keys are dropped, so the clients send their keys again.
+    bool load(std::vector<std::string> const& files);
+
+    /// Write the loaded model in the compiled format, which is memory-mapped by load().
+    bool save(std::string const& file) const;
+
+    /// Fix the seed of the blinding randomness, for reproducible runs.
+    /// By default the seed is drawn from NTL's random stream.
+    void set_seed(long seed);
+
+    /// The number of client keys kept across sessions, 8 by default.
+    /// Clients that reconnect with cached keys skip sending them.
+    void set_key_cache_size(size_t size);
+
+    /// The largest evaluation key accepted from a client, 64 MiB by default.
+    /// A key is also limited by the size that its context implies, see wire::max_pubkey_payload().
+    void set_max_key_size(size_t bytes);
+
+    /// Serve one session. Safe to call concurrently once the model is loaded.
     void run(tcp::iostream &conn) ;
 
 private:
     struct Imp;
+    struct Session;
     std::shared_ptr<Imp> imp_;
 };
 
@@ -29,8 +54,20 @@ public:
 
     bool load(std::string const& file);
 
+    /// Ask for the packed response, i.e., a few ciphertexts instead of two per path.
+    /// It needs extra key switching matrices, so call it before the first run.
+    void set_packed_response(bool packed);
+
+    /// Upload the features as seeded ciphertexts, i.e., a seed instead of the uniform part.
+    /// It halves the upload, and costs the server an expansion per feature.
+    void set_seeded_upload(bool seeded);
+
     void run(tcp::iostream &conn);
 
+    /// The labels of each query of the last run, one per tree, -1 if none is found.
+    /// The queries after a failure are missing.
+    std::vector<std::vector<long>> labels() const;
+
 private:
     struct Imp;
     std::shared_ptr<Imp> imp_;
@@ -0,0 +1,86 @@
+#ifndef PRIVATE_GREATER_THAN_PPDT_MODEL_HPP
+#define PRIVATE_GREATER_THAN_PPDT_MODEL_HPP
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// A compiled decision tree, stored as flat int64 arrays in one contiguous buffer.
+/// The buffer is written to disk as it is, so a compiled model is memory-mapped
+/// and used in place without parsing.
+///
+/// Layout (in words of int64, host byte order):
+///   header: MAGIC | VERSION | nodes | paths | path_nodes | max_feature_index
+///   feature[nodes] | threshold[nodes] | left[nodes] | right[nodes]
+///   path_offset[paths + 1] | path_node[path_nodes] | left_turns[paths]
+/// The internal nodes are indexed densely. A child c >= 0 is an internal node,
+/// and c < 0 is the leaf that ends path (-c - 1). The i-th path lists its internal
+/// nodes from the root in path_node[path_offset[i], path_offset[i + 1]).
+class PPDTModel {
+public:
+    static const int64_t MAGIC = 0x4c444f4d54445050LL; // "PPDTMODL"
+    static const int64_t VERSION = 1;
+
+    PPDTModel();
+
+    ~PPDTModel();
+
+    PPDTModel(PPDTModel const& oth) = delete;
+
+    PPDTModel& operator=(PPDTModel const& oth) = delete;
+
+    /// paths[i] lists the internal nodes along the i-th path from the root.
+    bool build(std::vector<int64_t> const& feature,
+               std::vector<int64_t> const& threshold,
+               std::vector<int64_t> const& left,
+               std::vector<int64_t> const& right,
+               std::vector<std::vector<int64_t>> const& paths,
+               std::vector<int64_t> const& left_turns);
+
+    /// Memory-map a compiled model. Return false if the file is not a valid model.
+    bool map(std::string const& file);
+
+    bool save(std::string const& file) const;
+
+    /// Whether the file starts with MAGIC.
+    static bool is_compiled(std::string const& file);
+
+    bool empty() const { return base_ == nullptr; }
+
+    size_t nodes_count() const { return nodes_; }
+
+    size_t paths_count() const { return paths_; }
+
+    long max_feature_index() const { return max_feature_index_; }
+
+    const int64_t *feature() const { return feature_; }
+
+    const int64_t *threshold() const { return threshold_; }
+
+    const int64_t *left() const { return left_; }
+
+    const int64_t *right() const { return right_; }
+
+    const int64_t *path_begin(size_t i) const { return path_node_ + path_offset_[i]; }
+
+    const int64_t *path_end(size_t i) const { return path_node_ + path_offset_[i + 1]; }
+
+    long left_turns(size_t i) const { return left_turns_[i]; }
+
+private:
+    void release();
+
+    /// Set the array pointers from base_ and check the structure.
+    bool bind(const int64_t *base, size_t words);
+
+    std::vector<int64_t> owned_;
+    void *mapped_;
+    size_t mapped_size_;
+
+    const int64_t *base_;
+    size_t words_;
+    size_t nodes_, paths_;
+    long max_feature_index_;
+    const int64_t *feature_, *threshold_, *left_, *right_;
+    const int64_t *path_offset_, *path_node_, *left_turns_;
+};
+#endif // PRIVATE_GREATER_THAN_PPDT_MODEL_HPP
@@ -4,6 +4,9 @@
 #include <boost/asio/ip/tcp.hpp>
 #include <functional>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 using boost::asio::ip::tcp;
 using routine_t = std::function<void(tcp::iostream &)>;
@@ -20,5 +23,40 @@ void send_context(std::ostream &s, FHEcontext const& context);
 
 int run_server(routine_t server_routine);
 
+/// Configuration of the long-lived server.
+struct ServerOptions {
+    size_t workers;     // number of sessions served concurrently
+    size_t queue_depth; // accepted connections waiting for a free worker
+    long max_sessions;  // stop after this many sessions, negative for never
+    /// The deadline of a whole session, after which its stream fails, so a stalled
+    /// client can not hold a worker forever. Zero for none.
+    std::chrono::seconds session_timeout;
+    std::atomic<bool> const* stop; // stop accepting once set, nullptr for never
+    ServerOptions() : workers(4), queue_depth(16), max_sessions(-1),
+                      session_timeout(600), stop(nullptr) {}
+};
+
+/// Per-session latency counters, updated by the workers.
+/// queue time is from accepting the connection to a worker picking it up,
+/// and service time is the time spent in the server routine.
+struct ServerStats {
+    std::atomic<uint64_t> sessions;
+    std::atomic<uint64_t> in_flight;
+    std::atomic<uint64_t> queue_ns;
+    std::atomic<uint64_t> service_ns;
+    std::atomic<uint64_t> max_service_ns;
+    ServerStats() : sessions(0), in_flight(0), queue_ns(0),
+                    service_ns(0), max_service_ns(0) {}
+
+    void record(uint64_t queue, uint64_t service);
+
+    void report(std::ostream &os) const;
+};
+
+/// Accept clients until max_sessions is reached or stop is set, and hand each session to a
+/// pool of workers. Accepting blocks when the queue is full, so the kernel backlog absorbs bursts.
+/// On shutdown, the acceptor is closed first, and then the queued sessions are served.
+int run_server(routine_t server_routine, ServerOptions const& opts, ServerStats *stats = nullptr);
+
 int run_client(routine_t client_routine);
 #endif // PRIVATE_GREATER_THAN_NETWORK_NET_IO_HPP
@@ -0,0 +1,95 @@
+#ifndef PRIVATE_GREATER_THAN_NETWORK_WIRE_HPP
+#define PRIVATE_GREATER_THAN_NETWORK_WIRE_HPP
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+
+class FHEcontext; // From HElib
+class FHEPubKey; // From HElib
+class Ctxt; // From HElib
+struct SeededCtxt; // From PrivateGreaterThan
+/// The binary wire format between PPDTClient and PPDTServer.
+/// Every message is a frame: a 16-byte header followed by the payload.
+///   magic "PPDT" (4 bytes) | version (uint16) | type (uint16) | payload length (uint64)
+/// All integers are little-endian. The payloads of contexts, keys and ciphertexts
+/// are HElib's binary serialization, i.e., raw per-prime residues instead of decimal text.
+namespace wire {
+const uint16_t VERSION = 1;
+/// The limit of the frames without a tighter one, i.e., PUBKEY read without a context limit.
+/// Payloads are read in chunks, so a peer has to send the bytes to make us allocate them.
+const uint64_t MAX_PAYLOAD = 1ULL << 32;
+/// The limit of a CONTEXT frame, which holds a few parameters and the primes.
+const uint64_t MAX_CONTEXT_PAYLOAD = 1ULL << 16;
+/// The largest m of a context from a peer, checked before the context is built.
+const unsigned long MAX_M = 1UL << 16;
+
+enum class FrameType : uint16_t {
+    CONTEXT = 1,
+    PUBKEY = 2,
+    CTXT = 3,
+    COUNT = 4,
+    FINGERPRINT = 5,
+    SEEDED_CTXT = 6,
+};
+
+/// Flags of the session mode, sent by the client after the keys.
+/// The server replies with the flags it accepts.
+const int64_t MODE_PACKED_RESPONSE = 1; // see PPDTServer::Session::evaluate_packed()
+const int64_t MODE_SEEDED_UPLOAD = 2; // features in SEEDED_CTXT frames
+
+const size_t FINGERPRINT_SIZE = 32;
+
+/// Header and payload are written with one call, i.e., one flush on a unitbuf stream.
+void write_frame(std::ostream &os, FrameType type, std::string const& payload);
+
+/// Return false on a broken stream, a bad header, an unexpected frame type,
+/// or a payload longer than min(max_length, max_payload(expected)).
+bool read_frame(std::istream &is, FrameType expected, std::string &payload,
+                uint64_t max_length = MAX_PAYLOAD);
+
+/// The fixed limit of each frame type, e.g., 8 bytes for COUNT.
+uint64_t max_payload(FrameType type);
+
+/// The limit of a CTXT frame under the context, from its number of primes and phi(m).
+uint64_t max_ctxt_payload(FHEcontext const& context);
+
+/// The limit of a PUBKEY frame under the context: the public encryption key, and the key
+/// switching matrices of the relinearization, the greater-than automorphism and the
+/// packing trace, each with one polynomial per digit.
+uint64_t max_pubkey_payload(FHEcontext const& context);
+
+void send_count(std::ostream &os, int64_t count);
+bool receive_count(std::istream &is, int64_t &count);
+
+void send_ctxt(std::ostream &os, Ctxt const& ctxt);
+bool receive_ctxt(std::istream &is, Ctxt &ctxt);
+
+/// seed (SEED_SIZE bytes) | noise_var (IEEE-754 double) | HElib's binary DoubleCRT a.
+const size_t SEED_SIZE = 32;
+void send_seeded_ctxt(std::ostream &os, SeededCtxt const& ctxt);
+/// Receive and expand it into ctxt.
+bool receive_seeded_ctxt(std::istream &is, Ctxt &ctxt);
+
+void send_pubkey(std::ostream &os, FHEPubKey const& pk);
+/// The payload is limited by max_pubkey_payload() of the context of pk.
+bool receive_pubkey(std::istream &is, FHEPubKey &pk);
+
+void send_context(std::ostream &os, FHEcontext const& context);
+/// Return nullptr on failure.
+std::unique_ptr<FHEcontext> receive_context(std::istream &is);
+
+/// The payloads of the CONTEXT and PUBKEY frames.
+std::string serialize_context(FHEcontext const& context);
+std::unique_ptr<FHEcontext> parse_context(std::string const& payload);
+std::string serialize_pubkey(FHEPubKey const& pk);
+bool parse_pubkey(std::string const& payload, FHEPubKey &pk);
+
+/// A FINGERPRINT_SIZE-byte digest (NTL::DeriveKey) of the serialized keys.
+/// Clients that reconnect with the same keys send the fingerprint first,
+/// so the server can skip the transfer of the keys.
+std::string fingerprint(std::string const& context_payload, std::string const& pubkey_payload);
+void send_fingerprint(std::ostream &os, std::string const& fp);
+bool receive_fingerprint(std::istream &is, std::string &fp);
+} // namespace wire
+#endif // PRIVATE_GREATER_THAN_NETWORK_WIRE_HPP
@@ -0,0 +1,62 @@
+#ifndef PRIVATE_GREATER_THAN_UTIL_BLOCKING_QUEUE_HPP
+#define PRIVATE_GREATER_THAN_UTIL_BLOCKING_QUEUE_HPP
+#include <condition_variable>
+#include <mutex>
+#include <deque>
+
+namespace util {
+/// A bounded multi-producer multi-consumer queue.
+/// push() blocks while the queue is full, which gives back-pressure to the producer.
+template <typename T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1), closed_(false) {}
+
+    BlockingQueue(BlockingQueue const& oth) = delete;
+
+    BlockingQueue& operator=(BlockingQueue const& oth) = delete;
+
+    /// Return false if the queue has been closed.
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_full_.wait(lock, [this]() { return closed_ or items_.size() < capacity_; });
+        if (closed_)
+            return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    /// Return false if the queue has been closed and drained.
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mtx_);
+        not_empty_.wait(lock, [this]() { return closed_ or !items_.empty(); });
+        if (items_.empty())
+            return false;
+        item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return items_.size();
+    }
+
+private:
+    const size_t capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    mutable std::mutex mtx_;
+    std::condition_variable not_full_, not_empty_;
+};
+} // namespace util
+#endif // PRIVATE_GREATER_THAN_UTIL_BLOCKING_QUEUE_HPP
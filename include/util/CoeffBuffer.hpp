@@ -0,0 +1,66 @@
+#ifndef PRIVATE_GREATER_THAN_UTIL_COEFF_BUFFER_HPP
+#define PRIVATE_GREATER_THAN_UTIL_COEFF_BUFFER_HPP
+#include <cstdint>
+#include <vector>
+
+namespace NTL { class ZZX; }
+namespace util {
+enum class SimdLevel { SCALAR = 0, AVX2 = 1, AVX512 = 2 };
+
+/// The best instruction set supported by the running CPU, detected once.
+SimdLevel detected_simd_level();
+
+/// The instruction set used by the kernels. It is detected_simd_level() unless forced.
+SimdLevel simd_level();
+
+/// Force the kernels to an instruction set, e.g., SCALAR for testing.
+/// Levels above detected_simd_level() are clamped.
+void force_simd_level(SimdLevel level);
+
+/// The coefficients of a polynomial in Z_q[X]/(X^n + 1) as machine words,
+/// e.g., modulo the plaintext space or modulo one CRT prime.
+/// The kernels work on whole words instead of NTL::ZZ coefficients.
+/// Requires q < 2^62 so that the sum of two residues fits a signed word.
+class CoeffBuffer {
+public:
+    CoeffBuffer(long n, uint64_t q);
+
+    long size() const {
+        return static_cast<long>(coeffs_.size());
+    }
+
+    uint64_t modulus() const {
+        return q_;
+    }
+
+    uint64_t* data() {
+        return coeffs_.data();
+    }
+
+    const uint64_t* data() const {
+        return coeffs_.data();
+    }
+
+    /// Set all the coefficients to v mod q, v can be negative.
+    void fill(long v);
+
+    /// out = this * X^k mod X^n + 1, i.e., the negacyclic rotation. k can be negative.
+    void rotate(CoeffBuffer &out, long k) const;
+
+    /// Negate the coefficients [from, n).
+    void negate_suffix(long from);
+
+    /// Add c mod q to all the coefficients.
+    void add_constant(long c);
+
+    /// Convert to ZZX, in [-q/2, q/2) if centered, otherwise in [0, q).
+    void to_ZZX(NTL::ZZX &poly, bool centered = true) const;
+
+private:
+    uint64_t reduce(long v) const;
+
+    std::vector<uint64_t> coeffs_;
+    uint64_t q_;
+};
+} // namespace util
+#endif // PRIVATE_GREATER_THAN_UTIL_COEFF_BUFFER_HPP
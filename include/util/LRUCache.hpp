@@ -0,0 +1,79 @@
+#ifndef PRIVATE_GREATER_THAN_UTIL_LRU_CACHE_HPP
+#define PRIVATE_GREATER_THAN_UTIL_LRU_CACHE_HPP
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace util {
+/// A bounded least-recently-used cache. Thread-safe.
+/// V is copied out on get(), so use a shared_ptr for heavy values, which also
+/// keeps an evicted value alive until its last user drops it.
+template <typename K, typename V>
+class LRUCache {
+public:
+    explicit LRUCache(size_t capacity) : capacity_(capacity) {}
+
+    LRUCache(LRUCache const& oth) = delete;
+
+    LRUCache& operator=(LRUCache const& oth) = delete;
+
+    /// Return false on miss.
+    bool get(K const& key, V &value) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto kv = index_.find(key);
+        if (kv == index_.end())
+            return false;
+        items_.splice(items_.begin(), items_, kv->second);
+        value = kv->second->second;
+        return true;
+    }
+
+    void put(K const& key, V value) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (capacity_ == 0)
+            return;
+        auto kv = index_.find(key);
+        if (kv != index_.end()) {
+            kv->second->second = std::move(value);
+            items_.splice(items_.begin(), items_, kv->second);
+            return;
+        }
+        items_.emplace_front(key, std::move(value));
+        index_[key] = items_.begin();
+        evict();
+    }
+
+    void set_capacity(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        capacity_ = capacity;
+        evict();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        index_.clear();
+        items_.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mtx_);
+        return items_.size();
+    }
+
+private:
+    void evict() {
+        while (items_.size() > capacity_) {
+            index_.erase(items_.back().first);
+            items_.pop_back();
+        }
+    }
+
+    using item_t = std::pair<K, V>;
+    size_t capacity_;
+    std::list<item_t> items_; // most recently used first
+    std::unordered_map<K, typename std::list<item_t>::iterator> index_;
+    mutable std::mutex mtx_;
+};
+} // namespace util
+#endif // PRIVATE_GREATER_THAN_UTIL_LRU_CACHE_HPP
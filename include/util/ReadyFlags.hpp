@@ -0,0 +1,47 @@
+#ifndef PRIVATE_GREATER_THAN_UTIL_READY_FLAGS_HPP
+#define PRIVATE_GREATER_THAN_UTIL_READY_FLAGS_HPP
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace util {
+/// One flag per item of a batch that is produced out of order.
+/// A consumer that needs the items in order waits on each flag in turn.
+class ReadyFlags {
+public:
+    ReadyFlags() {}
+
+    ReadyFlags(ReadyFlags const& oth) = delete;
+
+    ReadyFlags& operator=(ReadyFlags const& oth) = delete;
+
+    void reset(size_t n) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        flags_.assign(n, 0);
+    }
+
+    void set(size_t i) {
+        std::lock_guard<std::mutex> lock(mtx_);
+        flags_.at(i) = 1;
+        cv_.notify_all();
+    }
+
+    /// Release all the waiters, e.g., when the producer fails.
+    void set_all() {
+        std::lock_guard<std::mutex> lock(mtx_);
+        flags_.assign(flags_.size(), 1);
+        cv_.notify_all();
+    }
+
+    void wait(size_t i) const {
+        std::unique_lock<std::mutex> lock(mtx_);
+        cv_.wait(lock, [this, i]() { return flags_.at(i) != 0; });
+    }
+
+private:
+    std::vector<char> flags_;
+    mutable std::mutex mtx_;
+    mutable std::condition_variable cv_;
+};
+} // namespace util
+#endif // PRIVATE_GREATER_THAN_UTIL_READY_FLAGS_HPP
@@ -0,0 +1,50 @@
+#ifndef PRIVATE_GREATER_THAN_UTIL_SAMPLER_HPP
+#define PRIVATE_GREATER_THAN_UTIL_SAMPLER_HPP
+#include <NTL/ZZ.h>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace NTL { class ZZX; }
+namespace util {
+/// Derive a NTL_PRG_KEYLEN-byte key from a key and a list of tags, e.g., (session, query, path).
+void derive_key(unsigned char *out, const unsigned char *key, std::initializer_list<long> tags);
+
+/// Sampler of the plaintext randomness used for blinding.
+/// It is backed by NTL's RandomStream (a ChaCha based CSPRNG) that it owns,
+/// so samplers of different threads never share any state.
+class Sampler {
+public:
+    /// Keyed from NTL's current random stream.
+    Sampler();
+
+    /// Keyed by (key, tags), which makes the output reproducible.
+    Sampler(const unsigned char *key, std::initializer_list<long> tags);
+
+    Sampler(Sampler const& oth) = delete;
+
+    Sampler& operator=(Sampler const& oth) = delete;
+
+    ~Sampler();
+
+    /// The sampler of the calling thread.
+    static Sampler& local();
+
+    void reseed(const unsigned char *key, std::initializer_list<long> tags);
+
+    /// Uniform in [0, p).
+    long uniform(long p);
+
+    /// Uniform in [1, p).
+    long non_zero(long p);
+
+    /// Set poly to a degree (n - 1) polynomial whose coefficients [from, n) are uniform in [0, p),
+    /// and those below from are zero. The randomness is drawn in one call.
+    void uniform_poly(NTL::ZZX &poly, long n, long p, long from = 0);
+
+private:
+    std::unique_ptr<NTL::RandomStream> stream_;
+    std::vector<unsigned char> buf_;
+};
+} // namespace util
+#endif // PRIVATE_GREATER_THAN_UTIL_SAMPLER_HPP
@@ -4,7 +4,7 @@
 #include <boost/algorithm/string.hpp>
 
 namespace util {
-std::string trim(const std::string &line) {
+inline std::string trim(const std::string &line) {
     size_t first = line.find_first_not_of(' ');
     if (first == std::string::npos)
         return line;
@@ -12,13 +12,13 @@ std::string trim(const std::string &line) {
     return line.substr(first, last - first + 1);
 }
 
-std::vector<std::string> split_by(std::string const& str, char delimiter) {
+inline std::vector<std::string> split_by(std::string const& str, char delimiter) {
     std::vector<std::string> fields;
     boost::split(fields, str, [delimiter](char c) -> bool { return c == delimiter; });
     return fields;
 }
 
-std::vector<std::string> split_by_space(std::string const& str) {
+inline std::vector<std::string> split_by_space(std::string const& str) {
     return split_by(str, ' ');
 }
 
@@ -1,51 +1,186 @@
 #include <NTL/ZZX.h>
 #include <HElib/DoubleCRT.h>
+#include <HElib/FHEContext.h>
+#include <iostream>
 
 #include "SymRLWE/Cipher.hpp"
+#include "SymRLWE/PrivateKey.hpp"
 Cipher::Cipher() {
 }
 
 Cipher::Cipher(const Cipher &oth) {
-    a = copy_ptr(oth.a);
-    b = copy_ptr(oth.b);
+    if (oth.a)
+        a = copy_ptr(oth.a);
+    if (oth.b)
+        b = copy_ptr(oth.b);
+    seed = oth.seed;
 }
 
-Cipher::Cipher(Cipher &&oth) {
-    a = std::move(oth.a);
-    b = std::move(oth.b);
-    oth.a = nullptr;
-    oth.b = nullptr;
+Cipher::Cipher(Cipher &&oth) noexcept
+    : a(std::move(oth.a)), b(std::move(oth.b)), seed(std::move(oth.seed)) {
 }
 
-Cipher& Cipher::operator=(Cipher &&oth) {
-    a = std::move(oth.a);
-    b = std::move(oth.b);
-    oth.a = nullptr;
-    oth.b = nullptr;
+/// Overwrite dst in place if it is over the same context, otherwise draw a copy from the pool.
+static void assign_poly(Polynomial_ptr &dst, const Polynomial_ptr &src) {
+    if (!src)
+        dst = nullptr;
+    else if (dst && &dst->getContext() == &src->getContext())
+        (*dst) = (*src);
+    else
+        dst = copy_ptr(src);
+}
+
+Cipher& Cipher::operator=(const Cipher &oth) {
+    if (this == &oth)
+        return *this;
+    assign_poly(a, oth.a);
+    assign_poly(b, oth.b);
+    seed = oth.seed;
+    return *this;
+}
+
+Cipher& Cipher::operator=(Cipher &&oth) noexcept {
+    Cipher(std::move(oth)).swap(*this);
+    return *this;
+}
+
+void Cipher::swap(Cipher &oth) noexcept {
+    a.swap(oth.a);
+    b.swap(oth.b);
+    seed.swap(oth.seed);
+}
+
+void Cipher::expand() {
+    if (!b) {
+        b = new_ptr(a);
+        sampleUniform(b.get(), *seed);
+    }
+    seed = nullptr;
 }
 
 Cipher& Cipher::operator*=(const NTL::ZZX &v) {
-    (*a) *= v;
-    (*b) *= v;
+    expand();
+    /// Convert v once instead of once per component.
+    auto encoded = new_ptr(a);
+    (*encoded) = v;
+    (*a) *= (*encoded);
+    (*b) *= (*encoded);
     return *this;
 }
 
+Cipher& Cipher::operator*=(const EncodedPlaintext &v) {
+    expand();
+    (*a) *= v.poly();
+    (*b) *= v.poly();
+    return *this;
+}
+
+/// The components are kept in DoubleCRT (evaluation) form, where X^k is not a rotation
+/// but a pointwise product with the evaluations of X^k. So X^k is encoded once and
+/// shared by the two components instead of rotating each of them in coefficient form,
+/// which would cost two inverse and two forward NTTs.
+Cipher& Cipher::mul_by_monomial(const long k) {
+    expand();
+    const FHEcontext &context = a->getContext();
+    NTL::ZZX monomial;
+    encodeOnDegree(&monomial, k, context);
+    const long phiM = context.zMStar.getPhiM();
+    long r = k % (phiM << 1);
+    if (r < 0)
+        r += (phiM << 1);
+    //!< X^k = -X^{k - N} for N <= k < 2N
+    if (r >= phiM)
+        monomial *= -1L;
+    auto encoded = new_ptr(a);
+    (*encoded) = monomial;
+    (*a) *= (*encoded);
+    (*b) *= (*encoded);
+    return *this;
+}
+
+/// The message lives in a, i.e., a + s * b = p * e + m.
 Cipher& Cipher::operator+=(const long v) {
-    (*b) += v;
+    expand();
+    (*a) += v;
+    return *this;
+}
+
+Cipher& Cipher::mul_add_constant(const NTL::ZZX &v, const long c) {
+    (*this) *= v;
+    (*a) += c;
+    return *this;
+}
+
+Cipher& Cipher::mul_add_constant(const EncodedPlaintext &v, const long c) {
+    (*this) *= v;
+    (*a) += c;
     return *this;
 }
 
 Cipher& Cipher::operator+=(const Cipher &oth) {
+    expand();
     (*a) += (*oth.a);
-    (*b) += (*oth.b);
+    if (oth.b) {
+        (*b) += (*oth.b);
+    } else {
+        auto oth_b = new_ptr(a);
+        sampleUniform(oth_b.get(), *oth.seed);
+        (*b) += (*oth_b);
+    }
     return *this;
 }
 
 Cipher& Cipher::power(const long k) {
+    expand();
     a->automorph(k);
     b->automorph(k);
     return *this;
 }
 
+/// A one-byte tag, then a, then the seed bytes or b.
+enum : unsigned char { FULL = 0, SEEDED = 1 };
+static const long SEED_BYTES = 32;
+
+bool Cipher::write(std::ostream &os) const {
+    /// Default-constructed or moved-from.
+    if (!a || (!seed && !b))
+        return false;
+    const unsigned char tag = seed ? SEEDED : FULL;
+    os.put(static_cast<char>(tag));
+    a->write(os);
+    if (seed) {
+        unsigned char bytes[SEED_BYTES];
+        NTL::BytesFromZZ(bytes, *seed, SEED_BYTES);
+        os.write(reinterpret_cast<const char *>(bytes), SEED_BYTES);
+    } else {
+        b->write(os);
+    }
+    return static_cast<bool>(os);
+}
+
+bool Cipher::read(std::istream &is, const FHEcontext &context,
+                  std::shared_ptr<PolynomialPool> pool) {
+    const int tag = is.get();
+    if (tag != FULL && tag != SEEDED)
+        return false;
+    auto new_a = pool ? pool->acquire() : std::make_shared<Polynomial>(context);
+    new_a->read(is);
+    if (!is)
+        return false;
+    if (tag == SEEDED) {
+        unsigned char bytes[SEED_BYTES];
+        if (!is.read(reinterpret_cast<char *>(bytes), SEED_BYTES))
+            return false;
+        set_cipher(new_a, nullptr, std::make_shared<NTL::ZZ>(NTL::ZZFromBytes(bytes, SEED_BYTES)));
+    } else {
+        auto new_b = new_ptr(new_a);
+        new_b->read(is);
+        if (!is)
+            return false;
+        set_cipher(new_a, new_b);
+    }
+    return true;
+}
+
 Cipher::~Cipher() {} 
 
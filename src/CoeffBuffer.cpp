@@ -0,0 +1,213 @@
+#include "util/CoeffBuffer.hpp"
+#include <NTL/ZZX.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define COEFF_BUFFER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace util {
+namespace {
+/// dst[i] = -src[i] mod q. dst and src may be the same.
+void negate_scalar(uint64_t *dst, const uint64_t *src, long len, uint64_t q) {
+    for (long i = 0; i < len; i++)
+        dst[i] = src[i] == 0 ? 0 : q - src[i];
+}
+
+/// x[i] = x[i] + c mod q, with c < q.
+void add_constant_scalar(uint64_t *x, long len, uint64_t c, uint64_t q) {
+    for (long i = 0; i < len; i++) {
+        uint64_t s = x[i] + c;
+        x[i] = s >= q ? s - q : s;
+    }
+}
+
+#ifdef COEFF_BUFFER_X86
+__attribute__((target("avx2")))
+void negate_avx2(uint64_t *dst, const uint64_t *src, long len, uint64_t q) {
+    const __m256i vq = _mm256_set1_epi64x(static_cast<long long>(q));
+    const __m256i zero = _mm256_setzero_si256();
+    long i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        __m256i is_zero = _mm256_cmpeq_epi64(x, zero);
+        __m256i neg = _mm256_andnot_si256(is_zero, _mm256_sub_epi64(vq, x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), neg);
+    }
+    negate_scalar(dst + i, src + i, len - i, q);
+}
+
+/// The residues are below 2^62, so signed comparisons are safe.
+__attribute__((target("avx2")))
+void add_constant_avx2(uint64_t *x, long len, uint64_t c, uint64_t q) {
+    const __m256i vq = _mm256_set1_epi64x(static_cast<long long>(q));
+    const __m256i vc = _mm256_set1_epi64x(static_cast<long long>(c));
+    long i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m256i s = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i)), vc);
+        __m256i lt_q = _mm256_cmpgt_epi64(vq, s);
+        s = _mm256_sub_epi64(s, _mm256_andnot_si256(lt_q, vq));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(x + i), s);
+    }
+    add_constant_scalar(x + i, len - i, c, q);
+}
+
+__attribute__((target("avx512f")))
+void negate_avx512(uint64_t *dst, const uint64_t *src, long len, uint64_t q) {
+    const __m512i vq = _mm512_set1_epi64(static_cast<long long>(q));
+    const __m512i zero = _mm512_setzero_si512();
+    long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m512i x = _mm512_loadu_si512(src + i);
+        __mmask8 non_zero = _mm512_cmpneq_epu64_mask(x, zero);
+        __m512i neg = _mm512_maskz_sub_epi64(non_zero, vq, x);
+        _mm512_storeu_si512(dst + i, neg);
+    }
+    negate_scalar(dst + i, src + i, len - i, q);
+}
+
+__attribute__((target("avx512f")))
+void add_constant_avx512(uint64_t *x, long len, uint64_t c, uint64_t q) {
+    const __m512i vq = _mm512_set1_epi64(static_cast<long long>(q));
+    const __m512i vc = _mm512_set1_epi64(static_cast<long long>(c));
+    long i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m512i s = _mm512_add_epi64(_mm512_loadu_si512(x + i), vc);
+        __mmask8 ge_q = _mm512_cmpge_epu64_mask(s, vq);
+        s = _mm512_mask_sub_epi64(s, ge_q, s, vq);
+        _mm512_storeu_si512(x + i, s);
+    }
+    add_constant_scalar(x + i, len - i, c, q);
+}
+#endif // COEFF_BUFFER_X86
+
+SimdLevel detect() {
+#ifdef COEFF_BUFFER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+#endif
+    return SimdLevel::SCALAR;
+}
+
+std::atomic<int> forced_level(-1);
+
+void negate(uint64_t *dst, const uint64_t *src, long len, uint64_t q) {
+    if (len <= 0)
+        return;
+    switch (simd_level()) {
+#ifdef COEFF_BUFFER_X86
+    case SimdLevel::AVX512:
+        negate_avx512(dst, src, len, q);
+        break;
+    case SimdLevel::AVX2:
+        negate_avx2(dst, src, len, q);
+        break;
+#endif
+    default:
+        negate_scalar(dst, src, len, q);
+    }
+}
+
+void add_constant(uint64_t *x, long len, uint64_t c, uint64_t q) {
+    if (len <= 0)
+        return;
+    switch (simd_level()) {
+#ifdef COEFF_BUFFER_X86
+    case SimdLevel::AVX512:
+        add_constant_avx512(x, len, c, q);
+        break;
+    case SimdLevel::AVX2:
+        add_constant_avx2(x, len, c, q);
+        break;
+#endif
+    default:
+        add_constant_scalar(x, len, c, q);
+    }
+}
+} // namespace
+
+SimdLevel detected_simd_level() {
+    static const SimdLevel level = detect();
+    return level;
+}
+
+SimdLevel simd_level() {
+    int forced = forced_level.load();
+    if (forced < 0)
+        return detected_simd_level();
+    return static_cast<SimdLevel>(std::min(forced, static_cast<int>(detected_simd_level())));
+}
+
+void force_simd_level(SimdLevel level) {
+    forced_level.store(static_cast<int>(level));
+}
+
+CoeffBuffer::CoeffBuffer(long n, uint64_t q) : coeffs_(std::max(0L, n), 0), q_(q) {
+    assert(q > 1 && q < (1ULL << 62));
+}
+
+uint64_t CoeffBuffer::reduce(long v) const {
+    long r = v % static_cast<long>(q_);
+    return static_cast<uint64_t>(r < 0 ? r + static_cast<long>(q_) : r);
+}
+
+void CoeffBuffer::fill(long v) {
+    std::fill(coeffs_.begin(), coeffs_.end(), reduce(v));
+}
+
+void CoeffBuffer::rotate(CoeffBuffer &out, long k) const {
+    assert(&out != this);
+    const long n = size();
+    out.coeffs_.resize(n);
+    out.q_ = q_;
+    if (n == 0)
+        return;
+    //!< X^{2n} = 1, and X^n = -1
+    k %= (n << 1);
+    if (k < 0)
+        k += (n << 1);
+    const bool negated = k >= n;
+    if (negated)
+        k -= n;
+    //!< the first n - k coefficients move up by k, and the last k wrap around with a flipped sign
+    const uint64_t *src = coeffs_.data();
+    uint64_t *dst = out.coeffs_.data();
+    if (negated) {
+        negate(dst + k, src, n - k, q_);
+        std::memcpy(dst, src + n - k, k * sizeof(uint64_t));
+    } else {
+        std::memcpy(dst + k, src, (n - k) * sizeof(uint64_t));
+        negate(dst, src + n - k, k, q_);
+    }
+}
+
+void CoeffBuffer::negate_suffix(long from) {
+    from = std::max(0L, std::min(from, size()));
+    negate(coeffs_.data() + from, coeffs_.data() + from, size() - from, q_);
+}
+
+void CoeffBuffer::add_constant(long c) {
+    util::add_constant(coeffs_.data(), size(), reduce(c), q_);
+}
+
+void CoeffBuffer::to_ZZX(NTL::ZZX &poly, bool centered) const {
+    const long n = size();
+    const uint64_t half = q_ >> 1;
+    poly.rep.SetLength(n);
+    for (long i = 0; i < n; i++) {
+        uint64_t v = coeffs_[i];
+        if (centered && v > half)
+            poly.rep[i] = -static_cast<long>(q_ - v);
+        else
+            poly.rep[i] = static_cast<long>(v);
+    }
+    poly.normalize();
+}
+} // namespace util
@@ -1,6 +1,8 @@
 #include "SymRLWE/GreaterThan.hpp"
 #include "SymRLWE/Cipher.hpp"
 #include "SymRLWE/PrivateKey.hpp"
+#include "SymRLWE/PolyOps.hpp"
+#include "util/CoeffBuffer.hpp"
 #include <HElib/FHEContext.h>
 
 static void create_test_v(NTL::ZZX *test_v, 
@@ -31,39 +33,67 @@ void create_greater_than_args(GreaterThanArgs *args,
     create_test_v(&(args->test_v), context);
 }
 
+static NTL::ZZX threshold_poly(long b,
+                               const GreaterThanArgs& args,
+                               const FHEcontext &context) {
+    //!< poly_b = (mu1 - mu0)/2 * X^{-b} * test_v \mod X^N + 1
+    const long phiM = context.zMStar.getPhiM();
+    util::CoeffBuffer scaled_test_v(phiM, context.alMod.getPPowR());
+    scaled_test_v.fill(args.ngt() - args.one_half);
+    util::CoeffBuffer rotated(phiM, context.alMod.getPPowR());
+    scaled_test_v.rotate(rotated, -b);
+    NTL::ZZX poly_b;
+    rotated.to_ZZX(poly_b);
+    return poly_b;
+}
+
+EncodedPlaintext encode_threshold(long b,
+                                  const GreaterThanArgs& args,
+                                  const FHEcontext &context) {
+    /// Over the primes of the cipher components, see PolynomialPool.
+    return EncodedPlaintext(threshold_poly(b, args, context), context, context.allPrimes());
+}
+
 Cipher greater_than(const Cipher &a, long b, 
                     const GreaterThanArgs& args,
                     const FHEcontext &context) {
-    NTL::ZZX poly_b;
-    encodeOnDegree(&poly_b, -b, context); 
-    //!< when b > 0, X^{-b} will bring negative coefficients, so just multiply it with -1
-    if (b > 0)
-        poly_b *= -1L;
-    poly_b *= (args.ngt() - args.one_half);
-    //!< poly_b = (mu1 - mu0)/2 * X^{-b} * test_v \mod X^N + 1
-    NTL::MulMod(poly_b, poly_b, args.test_v, context.zMStar.getPhimX());
+    Cipher result;
+    greater_than_into(result, a, b, args, context);
+    return result;
+}
 
-    Cipher result(a);
-    result *= poly_b;
-    //!< result = (mu1 + mu0)/2 + (mu1 - mu0)/2 * X^{a-b} * test_v 
-    result += args.one_half;// TODO(riku) should blind other terms
+Cipher greater_than(const Cipher &a, const EncodedPlaintext &b,
+                    const GreaterThanArgs& args,
+                    const FHEcontext &context) {
+    Cipher result;
+    greater_than_into(result, a, b, args, context);
     return result;
 }
 
+void greater_than_into(Cipher &out, const Cipher &a, long b,
+                       const GreaterThanArgs& args,
+                       const FHEcontext &context) {
+    out = a;
+    //!< out = (mu1 + mu0)/2 + (mu1 - mu0)/2 * X^{a-b} * test_v 
+    out.mul_add_constant(threshold_poly(b, args, context), args.one_half);// TODO(riku) should blind other terms
+}
+
+void greater_than_into(Cipher &out, const Cipher &a, const EncodedPlaintext &b,
+                       const GreaterThanArgs& args,
+                       const FHEcontext &/*context*/) {
+    out = a;
+    out.mul_add_constant(b, args.one_half);// TODO(riku) should blind other terms
+}
+
 NTL::ZZX greater_than(const NTL::ZZX &poly_a, long b, 
                       const GreaterThanArgs& args,
                       const FHEcontext &context) {
-    NTL::ZZX poly_b;
-    encodeOnDegree(&poly_b, -b, context); 
-    //!< when b > 0, X^{-b} will bring negative coefficients, so just multiply it with -1
-    if (b > 0)
-        poly_b *= -1L;
-    poly_b *= (args.ngt() - args.one_half);
-    //!< poly_b = (mu1 - mu0)/2 * X^{-b} * test_v \mod X^N + 1
-    NTL::MulMod(poly_b, poly_b, args.test_v, context.zMStar.getPhimX());
-
-    auto result(poly_a);
-    NTL::MulMod(result, result, poly_b, context.zMStar.getPhimX());
+    //!< result = poly_a * test_v * X^{-b} * (mu1 - mu0)/2 \mod X^N + 1
+    const long phiM = context.zMStar.getPhiM();
+    NTL::ZZX result;
+    mul_by_test_v(&result, poly_a, phiM);
+    mul_by_monomial(&result, result, -b, phiM);
+    result *= (args.ngt() - args.one_half);
     //!< result = (mu1 + mu0)/2 + (mu1 - mu0)/2 * X^{a-b} * test_v
     NTL::SetCoeff(result, 0, (result[0] + args.one_half) % context.alMod.getPPowR());
     return result;
@@ -1,108 +1,340 @@
 #include "network/PPDT.hpp"
 #include "network/net_io.hpp"
+#include "network/wire.hpp"
 #include "PrivateGreaterThan/GreaterThan.hpp"
 #include "util/Timer.hpp"
 #include <HElib/FHE.h>
 #include <HElib/FHEContext.h>
+#include "util/literal.hpp"
+#include "util/BlockingQueue.hpp"
+#include "util/ReadyFlags.hpp"
 
+#include <fstream>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <limits>
+#include <exception>
 
 struct PPDTClient::Imp {
-    Imp() {}
+    Imp() : packed_(false), seeded_(false) {}
     ~Imp() {}
+    /// One feature vector per line, e.g., 10,20,30,...
+    /// Use a fake feature vector for debug if the file can not be opened.
     bool load(std::string const& file) {
-        features_.resize(57);
-        // fake features for debug
-        for (long i = 0; i < features_.size(); i++)
-            features_[i] = 10 * (i + 1);
-        return true;
-    }
+        batch_.clear();
+        std::ifstream fd(file);
+        if (!fd.is_open()) {
+            std::vector<long> features(57);
+            for (size_t i = 0; i < features.size(); i++)
+                features[i] = 10 * (i + 1);
+            batch_.push_back(features);
+            return true;
+        }
 
-    void send_context(FHEcontext const&context, 
-                      std::ostream &conn) const {
-        ::send_context(conn, context);
+        for (std::string line; std::getline(fd, line); ) {
+            if (util::trim(line).empty())
+                continue;
+            auto fields = util::split_by(line, ',');
+            std::vector<long> features(fields.size());
+            for (size_t i = 0; i < fields.size(); i++) {
+                auto f = util::trim(fields[i]);
+                size_t pos;
+                features[i] = std::stol(f, &pos, 10);
+                if (pos != f.size()) {
+                    std::cerr << "Invalid feature " << f << "\n";
+                    return false;
+                }
+            }
+            batch_.push_back(features);
+        }
+        return !batch_.empty();
     }
 
-    void send_evk(FHESecKey const& sk,
-                  std::ostream &conn) const {
-        FHEPubKey ek(sk);
+    /// The keys are generated on the first run, and reused by the later runs,
+    /// i.e., reconnections, of this client.
+    void setup_keys() {
+        if (sk_)
+            return;
+        long m = 4096 << 1;
+        long p = 1031;
+        long L = 3;
+        context_.reset(new FHEcontext(m, p, 1));
+        context_->bitsPerLevel += 1;
+        buildModChain(*context_, L);
+        std::cout << "kappa " << context_->securityLevel() << std::endl;
+
+        sk_.reset(new FHESecKey(*context_));
+        sk_->GenSecKey(64);
+        setup_auxiliary_for_greater_than(sk_.get());
+        if (packed_)
+            setup_auxiliary_for_packing(sk_.get());
+        noise_var_ = fresh_noise_var(*sk_);
+        FHEPubKey ek(*sk_);
         ek.makeSymmetric();
-        conn << ek;
+        context_payload_ = wire::serialize_context(*context_);
+        evk_payload_ = wire::serialize_pubkey(ek);
+        fingerprint_ = wire::fingerprint(context_payload_, evk_payload_);
+    }
+
+    /// Send the fingerprint of the keys, and the keys themselves only if
+    /// the server has not cached them.
+    bool send_evk(std::iostream &conn) const {
+        wire::send_fingerprint(conn, fingerprint_);
+        int64_t cached = 0;
+        if (!wire::receive_count(conn, cached))
+            return false;
+        if (cached == 0) {
+            wire::write_frame(conn, wire::FrameType::CONTEXT, context_payload_);
+            wire::write_frame(conn, wire::FrameType::PUBKEY, evk_payload_);
+        }
+        return static_cast<bool>(conn);
     }
 
-    void encrypt_feature(FHESecKey const& sk) {
+    /// Encrypt the features on the omp workers, and stream them in order
+    /// from another thread as soon as each one is ready.
+    /// The seeded ciphertexts are sent if seeded, see wire::MODE_SEEDED_UPLOAD.
+    /// Return false if the connection is broken.
+    bool encrypt_and_send(std::vector<long> const& features,
+                          FHESecKey const& sk,
+                          bool seeded,
+                          std::ostream &conn) {
         auto start = Clock::now();
-        enc_features_.resize(features_.size(), sk);
-        for (size_t i = 0; i < features_.size(); i++) {
-            encrypt_in_degree(enc_features_[i], features_[i], sk);
+        const long num = features.size();
+        if (seeded)
+            seeded_features_.resize(num);
+        else
+            enc_features_.resize(num, sk);
+        features_ready_.reset(num);
+        bool sent = true;
+        std::atomic<bool> failed(false);
+        std::thread sender([&]() {
+            wire::send_count(conn, num);
+            for (long i = 0; i < num; i++) {
+                features_ready_.wait(i);
+                /// the flags are all set on failure, when the feature might not be encrypted
+                if (failed.load())
+                    break;
+                if (!conn)
+                    continue;
+                if (seeded)
+                    wire::send_seeded_ctxt(conn, seeded_features_[i]);
+                else
+                    wire::send_ctxt(conn, enc_features_[i]);
+            }
+            sent = static_cast<bool>(conn);
+        });
+#pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < num; i++) {
+            /// an exception must not leave the omp region, nor the sender waiting
+            try {
+                if (seeded)
+                    encrypt_in_degree(seeded_features_[i], features[i], sk, noise_var_);
+                else
+                    encrypt_in_degree(enc_features_[i], features[i], sk);
+                features_ready_.set(i);
+            } catch (std::exception const& e) {
+                std::cerr << "Failed to encrypt feature " << i << ": " << e.what() << std::endl;
+                failed.store(true);
+                features_ready_.set_all();
+            }
         }
+        sender.join();
         auto end = Clock::now();
-        enc_time_ = time_as_millsecond(end - start);
+        /// notice that this time include some network
+        enc_time_ += time_as_millsecond(end - start);
+        return sent && !failed.load();
     }
 
-    void send_encrypted_features(std::ostream &conn) const {
-        int32_t num = enc_features_.size();
-        conn << num << '\n';
-        for (const auto &ctx : enc_features_)
-            conn << ctx;
-    }
+    /// The decryption state of a tree, shared by the reader and the decryptor.
+    struct TreeResult {
+        TreeResult() : found(false), prediction(-1) {}
+        std::atomic<bool> found;
+        long prediction;
+    };
+
+    struct PathResult {
+        std::shared_ptr<TreeResult> tree;
+        std::unique_ptr<Ctxt> summation, label;
+    };
 
-    long wait_result(FHESecKey const& sk, 
-                     std::istream &conn) {
+    /// The server streams the (summation, label) pairs path by path, tree by tree.
+    /// This thread reads the pairs while another one decrypts them.
+    /// Once the zero summation of a tree is found, the rest pairs of the tree
+    /// are drained from the stream without decryption.
+    /// The trees are allocated as they arrive rather than from the claimed count.
+    /// Return the prediction of each tree, -1 if none is found.
+    std::vector<long> wait_result(FHESecKey const& sk, 
+                                  std::istream &conn) {
         auto start = Clock::now();
-        int32_t num;
-        conn >> num;
-        Ctxt summation(sk), label(sk);
-        bool need_dec = true;
-        long prediction = -1;
-        for (int32_t i = 0; i < num; i += 2) {
-            conn >> summation;
-            conn >> label;
-            if (need_dec) {
+        int64_t trees = 0;
+        if (!wire::receive_count(conn, trees) || trees < 0)
+            return {};
+        std::vector<std::shared_ptr<TreeResult>> results;
+        util::BlockingQueue<PathResult> pairs(16);
+        std::thread decryptor([&]() {
+            PathResult pair;
+            NTL::ZZX poly;
+            while (pairs.pop(pair)) {
+                TreeResult &tree = *pair.tree;
+                if (tree.found.load())
+                    continue;
+                Ctxt const& summation = *pair.summation;
+                Ctxt const& label = *pair.label;
                 if (!label.isCorrect())
                     std::cerr << "Warn. The decryption might fail" << std::endl;
-                NTL::ZZX poly;
                 sk.Decrypt(poly, summation);
                 if (NTL::coeff(poly, 0) == 0) {
                     sk.Decrypt(poly, label);
-                    prediction = NTL::to_long(NTL::coeff(poly, 0));
-                    need_dec = false;
+                    tree.prediction = NTL::to_long(NTL::coeff(poly, 0));
+                    tree.found.store(true);
                 }
-            } 
+            }
+        });
+
+        bool ok = true;
+        for (int64_t t = 0; t < trees && ok; t++) {
+            int64_t num = 0;
+            ok = wire::receive_count(conn, num);
+            results.push_back(std::make_shared<TreeResult>());
+            for (int64_t i = 0; i < num && ok; i += 2) {
+                PathResult pair;
+                pair.tree = results.back();
+                pair.summation.reset(new Ctxt(sk));
+                pair.label.reset(new Ctxt(sk));
+                ok = wire::receive_ctxt(conn, *pair.summation) && wire::receive_ctxt(conn, *pair.label);
+                if (ok && !pair.tree->found.load())
+                    pairs.push(std::move(pair));
+            }
         }
+        if (!ok)
+            std::cerr << "Error happned when to recevie result\n";
+        pairs.close();
+        decryptor.join();
+        std::vector<long> predictions;
+        for (auto const& tree : results)
+            predictions.push_back(tree->prediction);
         auto end = Clock::now();
         /// notice that this time include some network
-        dec_time_ = time_as_millsecond(end - start); 
-        return prediction;
+        dec_time_ += time_as_millsecond(end - start); 
+        return predictions;
+    }
+
+    /// The packed response, see PPDTServer::Session::evaluate_packed().
+    std::vector<long> wait_packed_result(FHESecKey const& sk,
+                                         std::istream &conn) {
+        auto start = Clock::now();
+        int64_t trees = 0;
+        if (!wire::receive_count(conn, trees) || trees < 0)
+            return {};
+        /// The counts come from the server, so the vectors only grow with the frames that arrive.
+        std::vector<int64_t> paths;
+        int64_t slots_cnt = 0;
+        for (int64_t t = 0; t < trees; t++) {
+            int64_t num = 0;
+            if (!wire::receive_count(conn, num) || num <= 0
+                || num > (std::numeric_limits<int64_t>::max() >> 1) - slots_cnt / 2)
+                return {};
+            paths.push_back(num);
+            slots_cnt += num << 1;
+        }
+        /// n is a power of two and at most N, and the packs cover exactly the slots.
+        int64_t n = 0, packs = 0;
+        const long N = sk.getContext().zMStar.getPhiM();
+        if (!wire::receive_count(conn, n) || !wire::receive_count(conn, packs)
+            || n <= 0 || n > N || (n & (n - 1)) != 0
+            || packs != slots_cnt / n + (slots_cnt % n != 0)) {
+            std::cerr << "Error happned when to recevie result\n";
+            return {};
+        }
+        std::vector<long> slots;
+        Ctxt packed(sk);
+        NTL::ZZX poly;
+        for (int64_t k = 0; k < packs; k++) {
+            if (!wire::receive_ctxt(conn, packed)) {
+                std::cerr << "Error happned when to recevie result\n";
+                return {};
+            }
+            sk.Decrypt(poly, packed);
+            auto values = unpack_constants(poly, n, sk.getContext());
+            slots.insert(slots.end(), values.begin(), values.end());
+        }
+
+        std::vector<long> predictions(trees, -1);
+        size_t slot = 0;
+        for (int64_t t = 0; t < trees; t++) {
+            for (int64_t i = 0; i < paths[t]; i++, slot += 2) {
+                if (slot + 1 >= slots.size())
+                    break;
+                if (predictions[t] == -1 && slots[slot] == 0)
+                    predictions[t] = slots[slot + 1];
+            }
+        }
+        auto end = Clock::now();
+        /// notice that this time include some network
+        dec_time_ += time_as_millsecond(end - start); 
+        return predictions;
     }
 
     void run(tcp::iostream &conn) {
-        long m = 4096 << 1;
-        long p = 1031;
-        long L = 3;
-        FHEcontext context(m, p, 1);
-        context.bitsPerLevel += 1;
-        buildModChain(context, L);
-        std::cout << "kappa " << context.securityLevel() << std::endl;
-        send_context(context, conn);
-
-        FHESecKey sk(context);
-        sk.GenSecKey(64);
-        setup_auxiliary_for_greater_than(&sk);
+        labels_.clear();
+        setup_keys();
+        FHESecKey const& sk = *sk_;
         auto start = Clock::now();
-        send_evk(sk, conn);
-        encrypt_feature(sk);
+        if (!send_evk(conn)) {
+            std::cerr << "Error happned when to send evaluation key\n";
+            return;
+        }
+
+        int64_t mode = 0;
+        if (packed_)
+            mode |= wire::MODE_PACKED_RESPONSE;
+        if (seeded_)
+            mode |= wire::MODE_SEEDED_UPLOAD;
+        wire::send_count(conn, mode);
+        if (!wire::receive_count(conn, mode)) {
+            std::cerr << "Error happned when to recevie session mode\n";
+            return;
+        }
+        const bool packed = (mode & wire::MODE_PACKED_RESPONSE) != 0;
+        const bool seeded = (mode & wire::MODE_SEEDED_UPLOAD) != 0;
 
-        send_encrypted_features(conn);
-        long label = wait_result(sk, conn);
+        /// All the queries in the batch share the evaluation key above.
+        wire::send_count(conn, batch_.size());
+        enc_time_ = dec_time_ = 0.;
+        for (auto const& features : batch_) {
+            if (!encrypt_and_send(features, sk, seeded, conn)) {
+                std::cerr << "Error happned when to send features\n";
+                break;
+            }
+            auto labels = packed ? wait_packed_result(sk, conn) : wait_result(sk, conn);
+            labels_.push_back(labels);
+            if (labels.size() == 1) {
+                std::cout << "prediction label is " << labels[0] << std::endl;
+            } else {
+                std::cout << "prediction labels are";
+                for (long label : labels)
+                    std::cout << " " << label;
+                std::cout << std::endl;
+            }
+        }
         auto end = Clock::now();
         end2end_time_ = time_as_millsecond(end - start);
-        std::cout << "prediction label is " << label << std::endl;
         std::cout << "ENC DEC ALL\n" << std::endl;
         printf("%.3f %.3f %.3f\n", enc_time_, dec_time_, end2end_time_);
     }
 
-    std::vector<long> features_;
+    bool packed_; // ask for the packed response
+    bool seeded_; // ask for the seeded upload
+    double noise_var_; // of the fresh ciphertexts under sk_
+    std::unique_ptr<FHEcontext> context_;
+    std::unique_ptr<FHESecKey> sk_;
+    std::string context_payload_, evk_payload_, fingerprint_;
+    std::vector<std::vector<long>> batch_;
+    std::vector<std::vector<long>> labels_; // of each query of the last run
     std::vector<Ctxt> enc_features_;
+    std::vector<SeededCtxt> seeded_features_;
+    util::ReadyFlags features_ready_;
     double enc_time_, dec_time_, end2end_time_;
 };
 
@@ -118,3 +350,21 @@ void PPDTClient::run(tcp::iostream &conn) {
     else
         std::cerr << "call PPDTClient::load first" << std::endl;
 }
+
+std::vector<std::vector<long>> PPDTClient::labels() const {
+    if (!imp_)
+        return {};
+    return imp_->labels_;
+}
+
+void PPDTClient::set_packed_response(bool packed) {
+    if (!imp_)
+        imp_.reset(new PPDTClient::Imp());
+    imp_->packed_ = packed;
+}
+
+void PPDTClient::set_seeded_upload(bool seeded) {
+    if (!imp_)
+        imp_.reset(new PPDTClient::Imp());
+    imp_->seeded_ = seeded;
+}
@@ -0,0 +1,233 @@
+#include "network/PPDTModel.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace {
+const size_t HEADER_WORDS = 6;
+}
+
+const int64_t PPDTModel::MAGIC;
+const int64_t PPDTModel::VERSION;
+
+PPDTModel::PPDTModel() : mapped_(nullptr), mapped_size_(0), base_(nullptr), words_(0),
+                         nodes_(0), paths_(0), max_feature_index_(-1),
+                         feature_(nullptr), threshold_(nullptr), left_(nullptr), right_(nullptr),
+                         path_offset_(nullptr), path_node_(nullptr), left_turns_(nullptr) {}
+
+PPDTModel::~PPDTModel() {
+    release();
+}
+
+void PPDTModel::release() {
+    if (mapped_)
+        munmap(mapped_, mapped_size_);
+    mapped_ = nullptr;
+    mapped_size_ = 0;
+    owned_.clear();
+    base_ = nullptr;
+    words_ = nodes_ = paths_ = 0;
+    max_feature_index_ = -1;
+}
+
+bool PPDTModel::build(std::vector<int64_t> const& feature,
+                      std::vector<int64_t> const& threshold,
+                      std::vector<int64_t> const& left,
+                      std::vector<int64_t> const& right,
+                      std::vector<std::vector<int64_t>> const& paths,
+                      std::vector<int64_t> const& left_turns) {
+    const size_t nodes = feature.size();
+    if (threshold.size() != nodes || left.size() != nodes || right.size() != nodes
+        || left_turns.size() != paths.size())
+        return false;
+    size_t path_nodes = 0;
+    for (auto const& path : paths)
+        path_nodes += path.size();
+    int64_t max_feature_index = -1;
+    for (int64_t f : feature)
+        max_feature_index = std::max(max_feature_index, f);
+
+    std::vector<int64_t> buf;
+    buf.reserve(HEADER_WORDS + 4 * nodes + 2 * paths.size() + 1 + path_nodes);
+    buf.push_back(MAGIC);
+    buf.push_back(VERSION);
+    buf.push_back(nodes);
+    buf.push_back(paths.size());
+    buf.push_back(path_nodes);
+    buf.push_back(max_feature_index);
+    buf.insert(buf.end(), feature.begin(), feature.end());
+    buf.insert(buf.end(), threshold.begin(), threshold.end());
+    buf.insert(buf.end(), left.begin(), left.end());
+    buf.insert(buf.end(), right.begin(), right.end());
+    int64_t offset = 0;
+    buf.push_back(offset);
+    for (auto const& path : paths) {
+        offset += path.size();
+        buf.push_back(offset);
+    }
+    for (auto const& path : paths)
+        buf.insert(buf.end(), path.begin(), path.end());
+    buf.insert(buf.end(), left_turns.begin(), left_turns.end());
+
+    release();
+    owned_.swap(buf);
+    return bind(owned_.data(), owned_.size());
+}
+
+bool PPDTModel::bind(const int64_t *base, size_t words) {
+    if (words < HEADER_WORDS || base[0] != MAGIC || base[1] != VERSION)
+        return false;
+    if (base[2] < 0 || base[3] < 0 || base[4] < 0)
+        return false;
+    const uint64_t nodes = base[2], paths = base[3], path_nodes = base[4];
+    /// words == HEADER_WORDS + 4 * nodes + 2 * paths + 1 + path_nodes, term by term without overflow.
+    uint64_t remain = words - HEADER_WORDS;
+    if (nodes > remain / 4)
+        return false;
+    remain -= 4 * nodes;
+    if (remain < 1 || paths > (remain - 1) / 2)
+        return false;
+    remain -= 2 * paths + 1;
+    if (path_nodes != remain)
+        return false;
+    /// A tree has at least one path, and only a single leaf has no internal node.
+    if (paths == 0 || (nodes == 0 && paths != 1))
+        return false;
+    const int64_t *ptr = base + HEADER_WORDS;
+    feature_ = ptr; ptr += nodes;
+    threshold_ = ptr; ptr += nodes;
+    left_ = ptr; ptr += nodes;
+    right_ = ptr; ptr += nodes;
+    path_offset_ = ptr; ptr += paths + 1;
+    path_node_ = ptr; ptr += path_nodes;
+    left_turns_ = ptr;
+
+    /// Check the structure once, so the evaluation can use the indices unchecked.
+    int64_t max_feature_index = -1;
+    for (size_t i = 0; i < nodes; i++) {
+        if (feature_[i] < 0)
+            return false;
+        max_feature_index = std::max(max_feature_index, feature_[i]);
+        for (int64_t c : {left_[i], right_[i]}) {
+            if (c >= (int64_t) nodes || c < -(int64_t) paths)
+                return false;
+        }
+    }
+    /// The features are allocated from max_feature_index, so it must be the exact one.
+    if (base[5] != max_feature_index)
+        return false;
+
+    /// The children form a tree rooted at node 0 that reaches every node and leaf once.
+    std::vector<int64_t> leaf_parent(paths, -1);
+    if (nodes > 0) {
+        std::vector<bool> reached(nodes, false);
+        std::vector<int64_t> stack = {0};
+        reached[0] = true;
+        while (!stack.empty()) {
+            const int64_t cur = stack.back();
+            stack.pop_back();
+            for (int64_t c : {left_[cur], right_[cur]}) {
+                if (c >= 0) {
+                    if (reached[c])
+                        return false;
+                    reached[c] = true;
+                    stack.push_back(c);
+                } else {
+                    if (leaf_parent[-c - 1] >= 0)
+                        return false;
+                    leaf_parent[-c - 1] = cur;
+                }
+            }
+        }
+        if (std::find(reached.begin(), reached.end(), false) != reached.end())
+            return false;
+        if (std::find(leaf_parent.begin(), leaf_parent.end(), -1) != leaf_parent.end())
+            return false;
+    }
+
+    if (path_offset_[0] != 0 || path_offset_[paths] != (int64_t) path_nodes)
+        return false;
+    for (size_t i = 0; i < paths; i++) {
+        if (path_offset_[i] > path_offset_[i + 1])
+            return false;
+    }
+    /// Each path goes from the root down to its own leaf, and turns left left_turns times.
+    for (size_t i = 0; i < paths; i++) {
+        const int64_t *begin = path_node_ + path_offset_[i];
+        const int64_t *end = path_node_ + path_offset_[i + 1];
+        if (nodes == 0) {
+            if (begin != end || left_turns_[i] != 0)
+                return false;
+            continue;
+        }
+        if (begin == end || *begin != 0)
+            return false;
+        int64_t turns = 0;
+        for (const int64_t *node = begin; node != end; ++node) {
+            if (*node < 0 || *node >= (int64_t) nodes)
+                return false;
+            const int64_t next = node + 1 != end ? node[1] : -(int64_t) i - 1;
+            if (next == left_[*node])
+                turns += 1;
+            else if (next != right_[*node])
+                return false;
+        }
+        if (turns != left_turns_[i])
+            return false;
+    }
+
+    base_ = base;
+    words_ = words;
+    nodes_ = nodes;
+    paths_ = paths;
+    max_feature_index_ = base[5];
+    return true;
+}
+
+bool PPDTModel::map(std::string const& file) {
+    release();
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size % sizeof(int64_t) != 0) {
+        close(fd);
+        return false;
+    }
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+    mapped_ = addr;
+    mapped_size_ = st.st_size;
+    if (!bind(static_cast<const int64_t *>(addr), st.st_size / sizeof(int64_t))) {
+        std::cerr << "Invalid compiled model: " << file << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+bool PPDTModel::save(std::string const& file) const {
+    if (empty())
+        return false;
+    std::ofstream fd(file, std::ios::binary | std::ios::trunc);
+    if (!fd.is_open())
+        return false;
+    fd.write(reinterpret_cast<const char *>(base_), words_ * sizeof(int64_t));
+    return static_cast<bool>(fd);
+}
+
+bool PPDTModel::is_compiled(std::string const& file) {
+    std::ifstream fd(file, std::ios::binary);
+    int64_t magic = 0;
+    if (!fd.read(reinterpret_cast<char *>(&magic), sizeof magic))
+        return false;
+    return magic == MAGIC;
+}
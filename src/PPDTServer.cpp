@@ -1,7 +1,12 @@
 #include "network/PPDT.hpp"
+#include "network/wire.hpp"
+#include "network/PPDTModel.hpp"
 #include "PrivateGreaterThan/GreaterThan.hpp"
 #include "util/literal.hpp"
 #include "util/Timer.hpp"
+#include "util/Sampler.hpp"
+#include "util/ReadyFlags.hpp"
+#include "util/LRUCache.hpp"
 
 #include <HElib/FHE.h>
 #include <HElib/FHEContext.h>
@@ -10,91 +15,68 @@
 #include <vector>
 #include <iostream>
 #include <memory>
-
-struct Tree {
-    // static std::atomic<size_t> counter;
-    /// WARN: not thread safe
-    Tree() : feature_index(-1), id(-1), left(nullptr), right(nullptr) {
-        //id = Tree::counter.fetch_add(1);
-    }
-
-    long feature_index;
-    long id;
-    struct Tree *left;
-    struct Tree *right;
-
-    bool is_leaf() const {
-        return !this->left and !this->right;
-    }
-
-    void free_tree(Tree *root) {
-        if (!root) 
-            return;
-        if (root->is_leaf()) {
-            delete root;
-        } else {
-            free_tree(root->left);
-            free_tree(root->right);
-        }
-    }
-
-    void print() {
-        print(this, "");
-    }
-
-    void print(Tree *root, std::string path) {
-        if (!root)
-            return;
-        if (root->is_leaf()) {
-            std::cout << path << " " << root->id << std::endl;
-        } else {
-            path = path + " " + std::to_string(root->id);
-            print(root->right, path);
-            print(root->left, path);
-        }
-    }
-};
-// std::atomic<size_t> Tree::counter(0);
-
-/// create X^{-b} mod X^m + 1
-static NTL::ZZX prepare_Xb(long b, GreaterThanArgs const& args, FHEcontext const& context) {
-	auto T(args.test_v);
-    long m = context.zMStar.getPhiM();
-    /// only works for X^N + 1 ring
-    assert(context.zMStar.getM() == (m << 1));
-    assert(b >= 0 && b < m);
-    T *= (args.ngt() - args.one_half);
-    if (b == 0)
-        return T;
-    for (long i = 0; i < b; i++) {
-        auto coeff = NTL::coeff(T, m - 1 - i);
-        NTL::SetCoeff(T, m - 1 - i, -coeff);
-    }
-    return T;
-}
-
-static void sample_random_poly(NTL::ZZX &poly, const long p) {
-    const long deg = NTL::deg(poly);
-    for (long i = 1; i <= deg; i++)
-        NTL::SetCoeff(poly, i, NTL::RandomBnd(p));
-}
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <exception>
 
 struct PathNode_t {
     long feature_index;
     long id;
-    const Tree *node;
-    PathNode_t() : feature_index(-1), id(-1), node(nullptr) {
+    PathNode_t() : feature_index(-1), id(-1) {
     }
 };
 using Path_t = std::vector<PathNode_t>;
 
+/// The deserialized keys of one client, together with the thresholds encoded
+/// under its context. Cached by the model, and shared by the sessions of the client.
+struct EvalKeys {
+    std::unique_ptr<FHEcontext> context;
+    std::unique_ptr<FHEPubKey> evk;
+    GreaterThanArgs gt_args;
+    std::unique_ptr<ThresholdCache> thresholds;
+    std::vector<const EncodedPlaintext *> threshold_polys; // indexed by internal node
+};
+
+/// The keys of the parameters used by PPDTClient take a few MiB.
+const uint64_t DEFAULT_MAX_KEY_SIZE = 64ULL << 20;
+
 struct PPDTServer::Imp {
-    using ctx_ptr_t = std::unique_ptr<Ctxt>;
-    Imp() {}
+    using keys_ptr_t = std::shared_ptr<const EvalKeys>;
+    Imp() : sessions_(0), key_cache_(8), max_key_size_(DEFAULT_MAX_KEY_SIZE), max_feature_index_(-1) {
+        NTL::GetCurrentRandomStream().get(seed_.data(), NTL_PRG_KEYLEN);
+    }
 
-    ~Imp() { root->free_tree(root); delete root;}
+    ~Imp() {}
+
+    /// Load one tree, or a forest of trees over the same features.
+    /// The new forest replaces the loaded one only if all the files are valid.
+    /// The cached keys are dropped, since their thresholds follow the numbering
+    /// of the comparisons of the replaced forest.
+    bool load(std::vector<std::string> const& files) {
+        std::vector<std::unique_ptr<PPDTModel>> trees;
+        for (auto const& file : files) {
+            std::unique_ptr<PPDTModel> tree(new PPDTModel());
+            if (!load_tree(file, *tree)) {
+                std::cerr << "Can not load the tree " << file << std::endl;
+                return false;
+            }
+            trees.push_back(std::move(tree));
+        }
+        if (trees.empty())
+            return false;
+        trees_.swap(trees);
+        index_model();
+        key_cache_.clear();
+        return true;
+    }
 
-    bool load(std::string const& file) {
+    /// Load either a compiled model (see PPDTModel), which is memory-mapped,
+    /// or the text format, which is compiled in memory.
+    bool load_tree(std::string const& file, PPDTModel &tree) {
+        if (PPDTModel::is_compiled(file))
+            return tree.map(file);
         std::ifstream fd(file);
         if (!fd.is_open())
             return false;
@@ -102,174 +84,17 @@ struct PPDTServer::Imp {
         ok &= load_threshold(fd);
         ok &= load_mapping(fd);
         ok &= load_path(fd);
-        ok &= build_tree_from_path();
+        ok = ok && build_model(tree);
         fd.close();
         return ok;
     }
 
-	bool recevie_features(std::vector<Ctxt> &features, 
-						  FHEPubKey const& evk,
-						  std::istream &conn) const {
-        int32_t num;
-        conn >> num;
-        features.resize(num, evk);
-        for (size_t i = 0; i < num; i++) {
-            conn >> features[i];
-        }
-        return true;
-    }
-
-    bool recevie_evk(FHEPubKey &evk, std::istream &conn) const {
-        conn >> evk;
-        return true;
-    }
-
-    void compare_all_internal_nodes(Tree *root, 
-									std::vector<Ctxt> const& features,
-									FHEcontext const& context) {
-        if (root->is_leaf())
-            return;
-        compare_all_internal_nodes(root->right, features, context);
-        compare_all_internal_nodes(root->left, features, context);
-        auto index = root->feature_index;
-        auto id = root->id;
-		NTL::ZZX threshold = prepare_Xb(thresholds_.at(id),
-										gt_args_,
-										context);
- 		assert(greater_than_.find(root->id) == greater_than_.end());
-        ctx_ptr_t f(new Ctxt(features.at(index)));
-        f->multByConstant(threshold);
-        greater_than_.insert(std::pair<int, ctx_ptr_t>(id, std::move(f)));
-    }
-    /// Walks along the path, and sum up the comparison results,
-    void sum_along_path(ctx_ptr_t &result, Path_t const& path) const {
-        if (path.empty())
-            return ;
-        size_t depth = path.size();
-        for (size_t i = 0; i < depth; i++) {
-            const Tree *node = path.at(i).node;
-            assert(node);
-            assert(node->feature_index == path.at(i).feature_index);
-            if (node->is_leaf()) {
-                assert(i + 1 == depth);
-                break;
-            }
-            auto kv = greater_than_.find(node->id);
-            assert(kv != greater_than_.end());
-            result->addCtxt(*(kv->second));
-        }
-    }
-
-    long count_left_nodes(Path_t const& path) const {
-        if (path.empty())
-            return 0;
-        long left_node = 0;
-        size_t depth = path.size();
-        for (size_t i = 0; i < depth; i++) {
-            const Tree *node = path.at(i).node;
-            assert(node);
-            assert(node->feature_index == path.at(i).feature_index);
-            if (node->is_leaf()) {
-                assert(i + 1 == depth);
-                break;
-            }
-            if (node->right->feature_index != path.at(i + 1).feature_index)
-                left_node += 1;
-        }
-        return left_node;
-    }
-
-    void sum_up_paths(FHEPubKey const& evk) {
-        const size_t paths_cnt = paths_.size();
-        const long phim = evk.getContext().zMStar.getPhiM();
-        const long p = evk.getContext().zMStar.getP();
-
-        summations_.resize(paths_cnt);
-        labeled_.resize(paths_cnt);
-//#pragma omp parallel
-        for (size_t i = 0; i < paths_cnt; i++) {
-            summations_[i].reset(new Ctxt(evk));
-            sum_along_path(summations_[i], paths_[i]);
-            long left_nodes_cnt = count_left_nodes(paths_[i]);
-            long depth = (paths_[i].size() - 1);
-            long modification = gt_args_.one_half * depth + left_nodes_cnt;
-            NTL::ZZX random;
-            random.SetLength(phim);
-            sample_random_poly(random, p);
-            NTL::SetCoeff(random, 0, modification);
-            summations_[i]->addConstant(random);
-            /// duplicate summations_[i]
-            labeled_[i].reset(new Ctxt(*summations_[i])); 
-        }
-    }
-
-    long random_non_zero(const long p) const {
-        long ret = 0;
-        do {
-            ret = NTL::RandomBnd(p);
-        } while (ret == 0);
-        return ret;
-    }
-
-    void randomize(const long p) {
-        const size_t paths_cnt = paths_.size();
-
-#pragma omp parallel
-        for (size_t i = 0; i < paths_cnt; i++) {
-            NTL::ZZX non_zero_random(0, 1);
-            long label = i; // TODO(riku) to use the true label
-            NTL::SetCoeff(non_zero_random, 0, random_non_zero(p));
-            labeled_[i]->multByConstant(non_zero_random);
-            labeled_[i]->addConstant(NTL::to_ZZX(i));
-            /// use two independent rands.
-            NTL::SetCoeff(non_zero_random, 0, random_non_zero(p)); 
-            summations_[i]->multByConstant(non_zero_random);
-            /// mod down to lowest level to reduce communication cost
-            labeled_[i]->modDownToLevel(1);
-            summations_[i]->modDownToLevel(1);
-        }
-    }
-
-    void response_result(tcp::iostream &conn) const {
-        assert(labeled_.size() == summations_.size());
-        int32_t num = labeled_.size();
-        conn << (num << 1);
-        for (size_t i = 0; i < labeled_.size(); i++) {
-            conn << (*summations_[i]);
-            conn << (*labeled_[i]);
-        }
-    }
-
-    void run(tcp::iostream &conn) {
-        auto _start = Clock::now();
-        FHEcontext context = receive_context(conn);
-        /// return 0 for greater, 1 other wise.
-		gt_args_ = create_greater_than_args(0L, 1L, context);
-        FHEPubKey evk(context);
-        if (!recevie_evk(evk, conn)) {
-            std::cerr << "Error happned when to recevie evaluation key\n";
-            return;
-        }
-
-        std::vector<Ctxt> features;
-        if (!recevie_features(features, evk, conn)) {
-            std::cerr << "Error happned when to recevie features\n";
-            return;
+    bool save(std::string const& file) const {
+        if (trees_.size() != 1) {
+            std::cerr << "Only a single tree can be saved" << std::endl;
+            return false;
         }
-
-        auto start = Clock::now(); 
-        compare_all_internal_nodes(root, features, context);
-        start = Clock::now();
-        sum_up_paths(evk);  
-        randomize(context.zMStar.getP());
-        auto end = Clock::now();
-        response_result(conn);
-        auto _end = Clock::now();
-
-        double evl_time = time_as_millsecond(end - start); 
-        double end2end_time = time_as_millsecond(_end - _start);
-        std::cout << "EVAL ALL" << std::endl;
-        printf("%.3f %.3f\n", evl_time, end2end_time);
+        return trees_[0]->save(file);
     }
 
     /// threshold format: i1,i2,i3, ...
@@ -350,7 +175,10 @@ struct PPDTServer::Imp {
             PathNode_t pn;
             pn.id = id;
             auto kv = id_2_feature_index_.find(id);
-            assert(kv != id_2_feature_index_.end());
+            if (kv == id_2_feature_index_.end()) {
+                std::cerr << "Unknown id " << id << "\n";
+                return false;
+            }
             pn.feature_index = kv->second;
             if (pn.feature_index < 0)
                 pn.feature_index = -1;
@@ -359,59 +187,649 @@ struct PPDTServer::Imp {
         return true;
     }
 
-    bool build_tree_from_path() {
-        root = new Tree();
-        for (auto &path : paths_) {
-            insert_path_to_tree(root, 0, path);
+    /// Insert the paths into a trie of node ids, and lay it out in the flat tree.
+    /// The first path through a node goes to its right child, and any other
+    /// child of the node is the left one.
+    /// The internal nodes are numbered in pre-order, right subtree first.
+    bool build_model(PPDTModel &tree) {
+        if (paths_.empty() or paths_[0].empty())
+            return false;
+        /// The trie, where -1 stands for no child.
+        std::vector<long> node_id, node_feature, node_left, node_right;
+        auto new_node = [&](PathNode_t const& pn) -> long {
+            node_id.push_back(pn.id);
+            node_feature.push_back(pn.feature_index);
+            node_left.push_back(-1);
+            node_right.push_back(-1);
+            return node_id.size() - 1;
+        };
+        new_node(paths_[0][0]);
+
+        std::vector<long> path_leaf(paths_.size());
+        std::vector<std::vector<long>> path_trie(paths_.size()); // the internal nodes along the path
+        std::vector<int64_t> left_turns(paths_.size(), 0);
+        for (size_t k = 0; k < paths_.size(); k++) {
+            Path_t const& path = paths_[k];
+            if (path.empty() or path[0].id != node_id[0]) {
+                std::cerr << "Path " << k << " does not start from the root\n";
+                return false;
+            }
+            long cur = 0;
+            for (size_t j = 1; j < path.size(); j++) {
+                path_trie[k].push_back(cur);
+                if (node_right[cur] < 0) {
+                    long child = new_node(path[j]); // new_node() grows the vectors
+                    node_right[cur] = child;
+                    cur = child;
+                } else if (node_id[node_right[cur]] == path[j].id) {
+                    cur = node_right[cur];
+                } else {
+                    if (node_left[cur] < 0) {
+                        long child = new_node(path[j]);
+                        node_left[cur] = child;
+                    } else if (node_id[node_left[cur]] != path[j].id) {
+                        std::cerr << "Node " << node_id[cur] << " has more than two children\n";
+                        return false;
+                    }
+                    cur = node_left[cur];
+                    left_turns[k] += 1;
+                }
+            }
+            path_leaf[k] = cur;
         }
-        // root->print();
-        return true;
+
+        /// leaves are referred to by their paths
+        /// -1 is the code of the leaf of path 0, so the claimed leaves are tracked aside.
+        std::vector<long> trie_2_flat(node_id.size(), -1);
+        std::vector<bool> claimed(node_id.size(), false);
+        for (size_t k = 0; k < paths_.size(); k++) {
+            long leaf = path_leaf[k];
+            if (node_left[leaf] >= 0 or node_right[leaf] >= 0 or claimed[leaf]) {
+                std::cerr << "Path " << k << " does not end at its own leaf\n";
+                return false;
+            }
+            trie_2_flat[leaf] = -(long) k - 1;
+            claimed[leaf] = true;
+        }
+        std::vector<long> internal_nodes;
+        std::vector<long> stack = {0};
+        while (!stack.empty()) {
+            long cur = stack.back();
+            stack.pop_back();
+            if (node_left[cur] < 0 and node_right[cur] < 0)
+                continue; // a leaf
+            if (node_left[cur] < 0 or node_right[cur] < 0) {
+                std::cerr << "Node " << node_id[cur] << " has only one child\n";
+                return false;
+            }
+            trie_2_flat[cur] = internal_nodes.size();
+            internal_nodes.push_back(cur);
+            stack.push_back(node_left[cur]);
+            stack.push_back(node_right[cur]);
+        }
+
+        const size_t nodes_cnt = internal_nodes.size();
+        std::vector<int64_t> feature(nodes_cnt), threshold(nodes_cnt), left(nodes_cnt), right(nodes_cnt);
+        for (size_t i = 0; i < nodes_cnt; i++) {
+            long cur = internal_nodes[i];
+            if (node_id[cur] >= (long) thresholds_.size()) {
+                std::cerr << "No threshold for node " << node_id[cur] << "\n";
+                return false;
+            }
+            feature[i] = node_feature[cur];
+            threshold[i] = thresholds_[node_id[cur]];
+            left[i] = trie_2_flat[node_left[cur]];
+            right[i] = trie_2_flat[node_right[cur]];
+        }
+        std::vector<std::vector<int64_t>> path_nodes(paths_.size());
+        for (size_t k = 0; k < paths_.size(); k++) {
+            for (long cur : path_trie[k])
+                path_nodes[k].push_back(trie_2_flat[cur]);
+        }
+        return tree.build(feature, threshold, left, right, path_nodes, left_turns);
     }
 
-    void insert_path_to_tree(Tree *tree, size_t pos, Path_t &path) {
-        if (pos >= path.size())
-            return ;
-        if (!tree)
-            return ;
-        bool has_next = (pos + 1) < path.size();
-        path.at(pos).node = tree;
-        if (tree->id == -1) {
-            tree->id = path.at(pos).id;
-            tree->feature_index = path.at(pos).feature_index;
-            if (has_next)
-                tree->right = new Tree();
-            insert_path_to_tree(tree->right, pos + 1, path);
-        } else {
-            assert(tree->id == path.at(pos).id);
-            if (tree->right) {
-                if (has_next and tree->right->id == path.at(pos + 1).id) {
-                    insert_path_to_tree(tree->right, pos + 1, path);
-                } else {
-                    if (!tree->left and has_next)
-                        tree->left = new Tree();
-                    insert_path_to_tree(tree->left, pos + 1, path);
+    /// Number the nodes and the paths of all the trees consecutively, and
+    /// dedupe the (feature, threshold) comparisons across the trees.
+    void index_model() {
+        node_base_.assign(1, 0);
+        path_base_.assign(1, 0);
+        for (auto const& tree : trees_) {
+            node_base_.push_back(node_base_.back() + tree->nodes_count());
+            path_base_.push_back(path_base_.back() + tree->paths_count());
+        }
+        path_tree_.resize(path_base_.back());
+        for (size_t t = 0; t < trees_.size(); t++)
+            std::fill(path_tree_.begin() + path_base_[t], path_tree_.begin() + path_base_[t + 1], t);
+
+        std::map<std::pair<int64_t, int64_t>, long> comparisons;
+        node_comparison_.resize(node_base_.back());
+        comparison_feature_.clear();
+        comparison_threshold_.clear();
+        max_feature_index_ = -1;
+        for (size_t t = 0; t < trees_.size(); t++) {
+            PPDTModel const& tree = *trees_[t];
+            max_feature_index_ = std::max(max_feature_index_, tree.max_feature_index());
+            for (size_t i = 0; i < tree.nodes_count(); i++) {
+                auto key = std::make_pair(tree.feature()[i], tree.threshold()[i]);
+                auto kv = comparisons.find(key);
+                if (kv == comparisons.end()) {
+                    kv = comparisons.insert({key, (long) comparison_feature_.size()}).first;
+                    comparison_feature_.push_back(key.first);
+                    comparison_threshold_.push_back(key.second);
+                }
+                node_comparison_[node_base_[t] + i] = kv->second;
+            }
+        }
+
+        /// Compare in the order that the features arrive.
+        compare_order_.resize(comparison_feature_.size());
+        for (size_t i = 0; i < compare_order_.size(); i++)
+            compare_order_[i] = i;
+        std::stable_sort(compare_order_.begin(), compare_order_.end(), [this](long a, long b) {
+            return comparison_feature_[a] < comparison_feature_[b];
+        });
+
+        /// Group the nodes of all the trees by depth for the top-down prefix sums.
+        parent_.assign(node_base_.back(), -1);
+        is_left_.assign(node_base_.back(), 0);
+        levels_.clear();
+        std::vector<long> level;
+        for (size_t t = 0; t < trees_.size(); t++) {
+            if (trees_[t]->nodes_count() > 0)
+                level.push_back(node_base_[t]);
+        }
+        while (!level.empty()) {
+            std::vector<long> next;
+            for (long node : level) {
+                const long t = std::upper_bound(node_base_.begin(), node_base_.end(), node) - node_base_.begin() - 1;
+                PPDTModel const& tree = *trees_[t];
+                const long local = node - node_base_[t];
+                for (int64_t child : {tree.right()[local], tree.left()[local]}) {
+                    if (child < 0)
+                        continue;
+                    parent_[node_base_[t] + child] = node;
+                    is_left_[node_base_[t] + child] = child == tree.left()[local];
+                    next.push_back(node_base_[t] + child);
                 }
-            } else {
-                if (has_next)
-                     tree->right = new Tree();
-                insert_path_to_tree(tree->right, pos + 1, path);
             }
+            levels_.push_back(std::move(level));
+            level = std::move(next);
         }
     }
 
+    void run(tcp::iostream &conn) const;
+
+    /// The blinding randomness of every session is derived from seed_.
+    void set_seed(long seed) {
+        NTL::DeriveKey(seed_.data(), NTL_PRG_KEYLEN,
+                       reinterpret_cast<const unsigned char *>(&seed), sizeof seed);
+        sessions_ = 0;
+    }
+
+    void derive_session_key(unsigned char *key) const {
+        long session = sessions_.fetch_add(1);
+        util::derive_key(key, seed_.data(), {session});
+    }
+
+    std::array<unsigned char, NTL_PRG_KEYLEN> seed_;
+    mutable std::atomic<long> sessions_;
+    mutable util::LRUCache<std::string, keys_ptr_t> key_cache_; // keyed by wire::fingerprint
+    uint64_t max_key_size_; // the limit of a PUBKEY frame
     std::vector<long> thresholds_;
     std::map<long, long> id_2_feature_index_;
     std::vector<Path_t> paths_;
-    std::map<size_t, ctx_ptr_t> greater_than_;
+    std::vector<std::unique_ptr<PPDTModel>> trees_; // the models used by the evaluation
+    /// The internal nodes and the paths of the t-th tree are numbered from
+    /// node_base_[t] and path_base_[t] in the whole forest.
+    std::vector<long> node_base_, path_base_;
+    std::vector<long> path_tree_; // the tree of each path
+    std::vector<long> node_comparison_; // the comparison of each internal node
+    std::vector<int64_t> comparison_feature_, comparison_threshold_;
+    std::vector<long> compare_order_; // comparisons sorted by feature index
+    std::vector<long> parent_; // parent of each internal node, -1 for the roots
+    std::vector<char> is_left_; // whether each internal node is the left child of its parent
+    std::vector<std::vector<long>> levels_; // internal nodes by depth
+    long max_feature_index_;
+};
+
+/// The per-session state of the server.
+/// The model (tree, paths and thresholds) is shared read-only by all the
+/// sessions, so that concurrent sessions never touch each other's ciphertexts.
+struct PPDTServer::Session {
+    using ctx_ptr_t = std::unique_ptr<Ctxt>;
+    explicit Session(PPDTServer::Imp const& model) : model_(model), query_(0), seeded_(false) {
+        model_.derive_session_key(session_key_.data());
+    }
+
+    /// Receive the features one by one, and release each one to the comparisons
+    /// as soon as it arrives. Return false on stream failure.
+    /// Only the features used by the forest are kept, so the memory does not
+    /// depend on the count claimed by the client. The rest are read and dropped.
+	bool recevie_features(std::vector<Ctxt> &features, 
+						  FHEPubKey const& evk,
+						  std::istream &conn) {
+        int64_t num = 0;
+        if (!wire::receive_count(conn, num) || num <= model_.max_feature_index_)
+            return false;
+        const int64_t used = model_.max_feature_index_ + 1;
+        features.resize(used, evk);
+        features_ready_.reset(used);
+        /// set before the ready flag, which stays the only one on failure
+        std::vector<char> arrived(used, 0);
+        bool received = true;
+        std::thread reader([&]() {
+            Ctxt unused(evk);
+            for (int64_t i = 0; i < num; i++) {
+                Ctxt &ctxt = i < used ? features[i] : unused;
+                bool ok = seeded_ ? wire::receive_seeded_ctxt(conn, ctxt)
+                                  : wire::receive_ctxt(conn, ctxt);
+                if (!ok) {
+                    received = false;
+                    features_ready_.set_all();
+                    return;
+                }
+                if (i < used) {
+                    arrived[i] = 1;
+                    features_ready_.set(i);
+                }
+            }
+        });
+        const bool compared = compare_all(features, arrived);
+        reader.join();
+        return received && compared;
+    }
+
+    /// The client sends the fingerprint of its keys first, and the server
+    /// answers 1 if the keys are cached. Otherwise, the client sends the context
+    /// and the evaluation key, which are cached under the fingerprint computed
+    /// here rather than the claimed one.
+    bool recevie_evk(std::iostream &conn) {
+        std::string fp;
+        if (!wire::receive_fingerprint(conn, fp))
+            return false;
+        PPDTServer::Imp::keys_ptr_t cached;
+        if (model_.key_cache_.get(fp, cached)) {
+            wire::send_count(conn, 1);
+            keys_ = cached;
+            return static_cast<bool>(conn);
+        }
+        wire::send_count(conn, 0);
+
+        /// The key is limited by its context, which is parsed first, and by the server.
+        std::string context_payload, pubkey_payload;
+        if (!wire::read_frame(conn, wire::FrameType::CONTEXT, context_payload))
+            return false;
+        std::shared_ptr<EvalKeys> keys(new EvalKeys());
+        keys->context = wire::parse_context(context_payload);
+        if (!keys->context)
+            return false;
+        const uint64_t max_key = std::min<uint64_t>(wire::max_pubkey_payload(*keys->context),
+                                                    model_.max_key_size_);
+        if (!wire::read_frame(conn, wire::FrameType::PUBKEY, pubkey_payload, max_key))
+            return false;
+        keys->evk.reset(new FHEPubKey(*keys->context));
+        if (!wire::parse_pubkey(pubkey_payload, *keys->evk))
+            return false;
+        /// return 0 for greater, 1 other wise.
+        keys->gt_args = create_greater_than_args(0L, 1L, *keys->context);
+        prepare_thresholds(*keys);
+        model_.key_cache_.put(wire::fingerprint(context_payload, pubkey_payload), keys);
+        keys_ = keys;
+        return true;
+    }
+
+    /// Evaluate every distinct (feature, threshold) comparison of the forest in parallel.
+    /// The comparisons are visited in the order of their features, waiting for each feature to arrive.
+    /// Return false if any comparison failed or any feature did not arrive, i.e., the flags
+    /// were released by a failing reader. The remaining comparisons are then skipped.
+    bool compare_all(std::vector<Ctxt> const& features, std::vector<char> const& arrived) {
+        const long comparisons_cnt = model_.comparison_feature_.size();
+        assert(model_.max_feature_index_ < (long) features.size());
+        greater_than_.resize(comparisons_cnt);
+        std::atomic<bool> failed(false);
+#pragma omp parallel for schedule(dynamic)
+        for (long k = 0; k < comparisons_cnt; k++) {
+            if (failed.load())
+                continue;
+            const long i = model_.compare_order_[k];
+            const long feature = model_.comparison_feature_[i];
+            features_ready_.wait(feature);
+            if (!arrived[feature]) {
+                failed.store(true);
+                continue;
+            }
+            /// an exception must not leave the omp region
+            try {
+                ctx_ptr_t f(new Ctxt(features.at(feature)));
+                f->multByConstant(keys_->threshold_polys[i]->poly());
+                greater_than_[i] = std::move(f);
+            } catch (std::exception const& e) {
+                std::cerr << "Failed to compare feature " << feature << ": " << e.what() << std::endl;
+                failed.store(true);
+            }
+        }
+        if (failed.load())
+            greater_than_.clear();
+        return !failed.load();
+    }
+
+    /// The threshold polynomials only depend on the model and the context,
+    /// so they are encoded once per client keys and shared by all the queries.
+    /// Comparisons with the same threshold share the encoded polynomial.
+    void prepare_thresholds(EvalKeys &keys) const {
+        const long comparisons_cnt = model_.comparison_threshold_.size();
+        keys.thresholds.reset(new ThresholdCache(*keys.context));
+        keys.threshold_polys.resize(comparisons_cnt);
+#pragma omp parallel for
+        for (long i = 0; i < comparisons_cnt; i++) {
+            keys.threshold_polys[i] = &keys.thresholds->get(model_.comparison_threshold_[i], keys.gt_args);
+        }
+    }
+    /// The signed sum along the edge from the node to its left or right child, on top of
+    /// the prefix of the node: plus the comparison of the node for the right child, which
+    /// is taken if the feature is greater, and minus it for the left one.
+    ctx_ptr_t extend_prefix(long node, bool left, FHEPubKey const& evk) const {
+        ctx_ptr_t sum(prefixes_[node] ? new Ctxt(*prefixes_[node]) : new Ctxt(evk));
+        sum->addCtxt(*greater_than_[model_.node_comparison_[node]], /*negative = */left);
+        return sum;
+    }
+
+    /// Set prefixes_[i] to the signed sum of the comparisons along the edges from the
+    /// root down to the i-th node, see extend_prefix(). Each node extends its parent's
+    /// prefix once, level by level, so the paths share their common prefixes: O(nodes)
+    /// additions instead of O(leaves * depth). All the trees go through the levels together.
+    /// The roots have no edges above them, so their prefixes stay empty.
+    void accumulate_prefixes(FHEPubKey const& evk) {
+        auto const& levels = model_.levels_;
+        prefixes_.clear();
+        prefixes_.resize(model_.node_comparison_.size());
+        for (size_t d = 1; d < levels.size(); d++) {
+            auto const& level = levels[d];
+#pragma omp parallel for
+            for (long j = 0; j < (long) level.size(); j++) {
+                const long node = level[j];
+                prefixes_[node] = extend_prefix(model_.parent_[node], model_.is_left_[node], evk);
+            }
+        }
+    }
+
+    /// Sum up the comparison results along the i-th path of the forest, and blind the sum.
+    /// The sum is the prefix of the last internal node on the path, extended to the leaf.
+    /// Each node adds one_half + v on the right and one_half - v on the left, where v is
+    /// -one_half if the feature is greater than the threshold and one_half otherwise.
+    /// So each node adds 0 if the path goes its way and 1 if not, and the sum is 0 exactly
+    /// on the path of the features.
+    void sum_up_path(long i, FHEPubKey const& evk) {
+        const long phim = evk.getContext().zMStar.getPhiM();
+        const long p = evk.getContext().zMStar.getP();
+        util::Sampler rnd(session_key_.data(), {query_, i, 0});
+        const long t = model_.path_tree_[i];
+        PPDTModel const& tree = *model_.trees_[t];
+        const long local = i - model_.path_base_[t];
+        if (tree.path_begin(local) == tree.path_end(local)) {
+            summations_[i].reset(new Ctxt(evk));
+        } else {
+            const long last = *(tree.path_end(local) - 1);
+            const bool left = tree.left()[last] == -local - 1;
+            summations_[i] = extend_prefix(model_.node_base_[t] + last, left, evk);
+        }
+        long depth = tree.path_end(local) - tree.path_begin(local);
+        long modification = keys_->gt_args.one_half * depth;
+        NTL::ZZX random;
+        rnd.uniform_poly(random, phim, p, 1);
+        NTL::SetCoeff(random, 0, modification);
+        summations_[i]->addConstant(random);
+        /// duplicate summations_[i]
+        labeled_[i].reset(new Ctxt(*summations_[i])); 
+    }
+
+    /// The packed response mods down after packing, see evaluate_packed().
+    void randomize_path(long i, const long p, bool mod_down = true) {
+        util::Sampler rnd(session_key_.data(), {query_, i, 1});
+        NTL::ZZX non_zero_random(0, 1);
+        /// the index of the path in its tree
+        long label = i - model_.path_base_[model_.path_tree_[i]]; // TODO(riku) to use the true label
+        NTL::SetCoeff(non_zero_random, 0, rnd.non_zero(p));
+        labeled_[i]->multByConstant(non_zero_random);
+        labeled_[i]->addConstant(NTL::to_ZZX(label));
+        /// use two independent rands.
+        NTL::SetCoeff(non_zero_random, 0, rnd.non_zero(p)); 
+        summations_[i]->multByConstant(non_zero_random);
+        /// mod down to lowest level to reduce communication cost
+        if (mod_down) {
+            labeled_[i]->modDownToLevel(1);
+            summations_[i]->modDownToLevel(1);
+        }
+    }
+
+    /// Send the pairs of the paths in order, each one as soon as it is ready.
+    /// The response is the number of trees, and then for each tree, the
+    /// number of ciphertexts followed by the pairs of its paths.
+    /// Return false if the connection is broken or the evaluation failed.
+    bool stream_result(std::ostream &conn, std::atomic<bool> const& failed) {
+        const long trees_cnt = model_.trees_.size();
+        const long paths_cnt = model_.path_base_.back();
+        wire::send_count(conn, trees_cnt);
+        for (long i = 0; i < paths_cnt; i++) {
+            const long t = model_.path_tree_[i];
+            if (i == model_.path_base_[t] && conn)
+                wire::send_count(conn, (model_.path_base_[t + 1] - model_.path_base_[t]) << 1);
+            paths_ready_.wait(i);
+            /// the flags are all set on failure, when the pair might not be computed
+            if (failed.load())
+                return false;
+            if (conn) {
+                wire::send_ctxt(conn, *summations_[i]);
+                wire::send_ctxt(conn, *labeled_[i]);
+            }
+            /// the pair is no longer needed once it is sent
+            summations_[i].reset();
+            labeled_[i].reset();
+        }
+        return static_cast<bool>(conn);
+    }
+
+    /// Sum up the paths and stream the result. The comparisons are already done
+    /// by recevie_features() while the feature vector arrives.
+    /// The paths are finished out of order by the omp workers, while a sender
+    /// thread writes them to the client in path order. Thus the transfer of the
+    /// early paths overlaps with the computation of the later ones.
+    bool evaluate(FHEPubKey const& evk, std::ostream &conn) {
+        const long p = evk.getContext().zMStar.getP();
+        const long paths_cnt = model_.path_base_.back();
+
+        summations_.resize(paths_cnt);
+        labeled_.resize(paths_cnt);
+        paths_ready_.reset(paths_cnt);
+        accumulate_prefixes(evk);
+        bool sent = true;
+        std::atomic<bool> failed(false);
+        std::thread sender([this, &conn, &sent, &failed]() { sent = stream_result(conn, failed); });
+#pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < paths_cnt; i++) {
+            /// an exception must not leave the omp region, nor the sender waiting
+            try {
+                sum_up_path(i, evk);
+                randomize_path(i, p);
+                paths_ready_.set(i);
+            } catch (std::exception const& e) {
+                std::cerr << "Failed to evaluate path " << i << ": " << e.what() << std::endl;
+                failed.store(true);
+                paths_ready_.set_all();
+            }
+        }
+        sender.join();
+        prefixes_.clear();
+        if (failed.load()) {
+            summations_.clear();
+            labeled_.clear();
+        }
+        return sent && !failed.load();
+    }
+
+    /// Pack the constant terms of all the summations and labels into a few
+    /// ciphertexts, see pack_constants(). The summation of the i-th path of the
+    /// forest goes to the slot 2i and its label to the slot 2i + 1. Each packed
+    /// ciphertext holds n slots, where n is a power of two and at most N.
+    /// The response is the number of trees, the number of paths of each tree,
+    /// n, the number of packed ciphertexts and then the ciphertexts.
+    /// The client decrypts a constant number of ciphertexts for small trees,
+    /// at the cost of O(log N) key switchings per packed ciphertext.
+    bool evaluate_packed(FHEPubKey const& evk, std::ostream &conn) {
+        FHEcontext const& context = evk.getContext();
+        const long p = context.zMStar.getP();
+        const long N = context.zMStar.getPhiM();
+        const long paths_cnt = model_.path_base_.back();
+
+        summations_.resize(paths_cnt);
+        labeled_.resize(paths_cnt);
+        accumulate_prefixes(evk);
+        std::atomic<bool> failed(false);
+#pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < paths_cnt; i++) {
+            try {
+                sum_up_path(i, evk);
+                randomize_path(i, p, /*mod_down = */false);
+            } catch (std::exception const& e) {
+                std::cerr << "Failed to evaluate path " << i << ": " << e.what() << std::endl;
+                failed.store(true);
+            }
+        }
+        prefixes_.clear();
+        if (failed.load()) {
+            summations_.clear();
+            labeled_.clear();
+            return false;
+        }
+
+        const long slots = paths_cnt << 1;
+        long n = 1;
+        while (n < slots && n < N)
+            n <<= 1;
+        const long packs = (slots + n - 1) / n;
+        const long trees_cnt = model_.trees_.size();
+        wire::send_count(conn, trees_cnt);
+        for (long t = 0; t < trees_cnt; t++)
+            wire::send_count(conn, model_.path_base_[t + 1] - model_.path_base_[t]);
+        wire::send_count(conn, n);
+        wire::send_count(conn, packs);
+        for (long k = 0; k < packs && conn; k++) {
+            std::vector<const Ctxt *> cts(n, nullptr);
+            for (long j = 0; j < n && k * n + j < slots; j++) {
+                const long slot = k * n + j;
+                cts[j] = (slot & 1) ? labeled_[slot >> 1].get() : summations_[slot >> 1].get();
+            }
+            Ctxt packed = pack_constants(cts, evk);
+            packed.modDownToLevel(1);
+            wire::send_ctxt(conn, packed);
+        }
+        summations_.clear();
+        labeled_.clear();
+        return static_cast<bool>(conn);
+    }
+
+    /// A session consists of one evaluation key and a batch of queries.
+    /// The client sends the session mode (see wire::MODE_PACKED_RESPONSE) and the number
+    /// of queries right after the key, and then each feature vector in turn, waiting for its result.
+    void run(tcp::iostream &conn) {
+        auto _start = Clock::now();
+        if (!recevie_evk(conn)) {
+            std::cerr << "Error happned when to recevie evaluation key\n";
+            return;
+        }
+        FHEPubKey const& evk = *keys_->evk;
+
+        /// The packed response falls back to the pairs without the packing matrices.
+        int64_t mode = 0;
+        if (!wire::receive_count(conn, mode)) {
+            std::cerr << "Error happned when to recevie session mode\n";
+            return;
+        }
+        const bool packed = (mode & wire::MODE_PACKED_RESPONSE) && can_pack_constants(evk);
+        seeded_ = (mode & wire::MODE_SEEDED_UPLOAD) != 0;
+        wire::send_count(conn, (packed ? wire::MODE_PACKED_RESPONSE : 0) |
+                               (seeded_ ? wire::MODE_SEEDED_UPLOAD : 0));
+
+        int64_t num_queries = 0;
+        if (!wire::receive_count(conn, num_queries)) {
+            std::cerr << "Error happned when to recevie number of queries\n";
+            return;
+        }
+        double evl_time = 0.;
+        std::vector<Ctxt> features;
+        for (int64_t q = 0; q < num_queries; q++) {
+            query_ = q;
+            /// notice that this time include receiving the features
+            auto start = Clock::now();
+            /// The query is aborted before evaluate() if any feature or comparison is missing.
+            if (!recevie_features(features, evk, conn)) {
+                std::cerr << "Error happned when to recevie features\n";
+                return;
+            }
+            bool sent = packed ? evaluate_packed(evk, conn) : evaluate(evk, conn);
+            auto end = Clock::now();
+            evl_time += time_as_millsecond(end - start);
+            if (!sent) {
+                std::cerr << "Error happned when to send result\n";
+                return;
+            }
+        }
+        auto _end = Clock::now();
+
+        double end2end_time = time_as_millsecond(_end - _start);
+        double throughput = num_queries / time_as_second(_end - _start);
+        std::cout << "QUERIES EVAL ALL CLS/S" << std::endl;
+        printf("%ld %.3f %.3f %.3f\n", static_cast<long>(num_queries), evl_time, end2end_time, throughput);
+    }
+
+    PPDTServer::Imp const& model_;
+    std::vector<ctx_ptr_t> greater_than_; // indexed by comparison
+    std::vector<ctx_ptr_t> prefixes_; // indexed by internal node of the forest
+    PPDTServer::Imp::keys_ptr_t keys_;
     std::vector<ctx_ptr_t> summations_, labeled_;
-    GreaterThanArgs gt_args_;
-    Tree *root;
+    util::ReadyFlags features_ready_; // set once the feature is received
+    util::ReadyFlags paths_ready_; // set once the path is blinded
+    std::array<unsigned char, NTL_PRG_KEYLEN> session_key_;
+    long query_; // index of the query in this session
+    bool seeded_; // the features are seeded ciphertexts
 };
 
+void PPDTServer::Imp::run(tcp::iostream &conn) const {
+    Session session(*this);
+    session.run(conn);
+}
+
 bool PPDTServer::load(std::string const& file) {
+    return load(std::vector<std::string>{file});
+}
+
+bool PPDTServer::load(std::vector<std::string> const& files) {
+    if (!imp_)
+        imp_.reset(new PPDTServer::Imp());
+    return imp_->load(files);
+}
+
+bool PPDTServer::save(std::string const& file) const {
+    return imp_ && imp_->save(file);
+}
+
+void PPDTServer::set_seed(long seed) {
+    if (!imp_)
+        imp_.reset(new PPDTServer::Imp());
+    imp_->set_seed(seed);
+}
+
+void PPDTServer::set_key_cache_size(size_t size) {
+    if (!imp_)
+        imp_.reset(new PPDTServer::Imp());
+    imp_->key_cache_.set_capacity(size);
+}
+
+void PPDTServer::set_max_key_size(size_t bytes) {
     if (!imp_)
         imp_.reset(new PPDTServer::Imp());
-    return imp_->load(file);
+    imp_->max_key_size_ = bytes;
 }
 
 void PPDTServer::run(tcp::iostream &conn) {
@@ -0,0 +1,53 @@
+#include "SymRLWE/PolyOps.hpp"
+#include <NTL/ZZX.h>
+#include <cassert>
+
+void mul_by_test_v(NTL::ZZX *out, const NTL::ZZX &a, long n) {
+    if (!out)
+        return;
+    const long deg_a = NTL::deg(a);
+    assert(deg_a < n);
+    NTL::ZZ total(0);
+    for (long i = 0; i <= deg_a; i++)
+        total += a[i];
+
+    NTL::ZZX result;
+    result.SetLength(n);
+    NTL::ZZ prefix(0);
+    for (long k = 0; k < n; k++) {
+        if (k <= deg_a)
+            prefix += a[k];
+        //!< 2 * prefix_k - total
+        result[k] = 2 * prefix - total;
+    }
+    result.normalize();
+    *out = result;
+}
+
+void mul_by_monomial(NTL::ZZX *out, const NTL::ZZX &a, long k, long n) {
+    if (!out)
+        return;
+    const long deg_a = NTL::deg(a);
+    assert(deg_a < n);
+    //!< X^{2n} = 1, and X^n = -1
+    k %= (n << 1);
+    if (k < 0)
+        k += (n << 1);
+    const bool negate = k >= n;
+    if (negate)
+        k -= n;
+
+    NTL::ZZX result;
+    result.SetLength(n);
+    for (long i = 0; i <= deg_a; i++) {
+        long j = i + k;
+        //!< wrapping around X^n flips the sign
+        if (j < n) {
+            result[j] = negate ? -a[i] : a[i];
+        } else {
+            result[j - n] = negate ? a[i] : -a[i];
+        }
+    }
+    result.normalize();
+    *out = result;
+}
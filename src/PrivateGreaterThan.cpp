@@ -3,8 +3,14 @@
 //
 
 #include "PrivateGreaterThan/GreaterThan.hpp"
+#include "util/Sampler.hpp"
+#include "util/CoeffBuffer.hpp"
+#include "SymRLWE/PrivateKey.hpp"
 #include <HElib/FHE.h>
+#include <HElib/binio.h>
 #include <NTL/ZZ_pX.h>
+#include <sstream>
+#include <cmath>
 // from SymRLWE
 extern void encodeOnDegree(NTL::ZZX *poly, long degree, FHEcontext const& context);
 /// Create a testing vector: 1 + X + X^2 + ... + X^{N-1}.
@@ -20,15 +26,12 @@ static NTL::ZZX create_test_v(FHEcontext const& context) {
         NTL::SetCoeff(test_v, i, 1);
     return test_v;
 }
-/// Generate a random polynomial from the plaintext
+/// Generate a random polynomial from the plaintext, using the sampler of the calling thread.
 static NTL::ZZX generate_random(FHEcontext const& context) {
-    /// (riku) Should backup the current modulus.
-    NTL::zz_pBak backup; backup.save();
-    NTL::zz_p::init(context.alMod.getPPowR());
-    NTL::zz_pX poly;
-    NTL::random(poly, context.zMStar.getPhiM());
-    backup.restore();
-    return NTL::conv<NTL::ZZX>(poly);
+    NTL::ZZX poly;
+    util::Sampler::local().uniform_poly(poly, context.zMStar.getPhiM(),
+                                        context.alMod.getPPowR());
+    return poly;
 }
 
 static void check_auxiliary(FHEPubKey const& pk) {
@@ -52,12 +55,23 @@ void setup_auxiliary_for_greater_than(FHESecKey *sk) {
 Ctxt greater_than(Ctxt const& ctx_a, Ctxt const& ctx_b,
                   GreaterThanArgs const& args,
                   FHEcontext const& context) {
+    return greater_than(ctx_a, ctx_b, args, encode_test_v(args, context), context);
+}
+
+EncodedPlaintext encode_test_v(GreaterThanArgs const& args, FHEcontext const& context) {
+    return EncodedPlaintext((args.mu1 - args.one_half) * args.test_v, context);
+}
+
+Ctxt greater_than(Ctxt const& ctx_a, Ctxt const& ctx_b,
+                  GreaterThanArgs const& args,
+                  EncodedPlaintext const& test_v,
+                  FHEcontext const& context) {
     check_auxiliary(ctx_a.getPubKey()); //sanity check
     Ctxt b_copy(ctx_b);
     smart_negate_degree(&b_copy, context); // X^{-b}
     b_copy.multiplyBy(ctx_a); // X^a * X^{-b}
 
-    b_copy.multByConstant((args.mu1 - args.one_half) * args.test_v);
+    b_copy.multByConstant(test_v.poly());
     NTL::ZZX r;
     if (args.randomized) {
         r = generate_random(context);
@@ -69,29 +83,27 @@ Ctxt greater_than(Ctxt const& ctx_a, Ctxt const& ctx_b,
     return b_copy;
 }
 
-static NTL::ZZX prepare_Xb(long b,
-                           GreaterThanArgs const& args,
-                           FHEcontext const& context) {
-    auto T(args.test_v);
+NTL::ZZX threshold_poly(long b,
+                        GreaterThanArgs const& args,
+                        FHEcontext const& context) {
     long m = context.zMStar.getPhiM();
     /// only works for X^N + 1 ring
     assert(context.zMStar.getM() == (m << 1));
     assert(b >= 0 && b < m);
-    T *= (args.ngt() - args.one_half);
-    if (b == 0)
-        return T;
-    for (long i = 0; i < b; i++) {
-        auto coeff = NTL::coeff(T, m - 1 - i);
-        NTL::SetCoeff(T, m - 1 - i, -coeff);
-    }
-    return T;
+    /// X^{-b} * test_v flips the sign of the top b coefficients of test_v.
+    util::CoeffBuffer T(m, context.alMod.getPPowR());
+    T.fill(args.ngt() - args.one_half);
+    T.negate_suffix(m - b);
+    NTL::ZZX poly;
+    T.to_ZZX(poly);
+    return poly;
 }
 
 Ctxt greater_than(Ctxt const& ctx_a, long b,
                   GreaterThanArgs const& args,
                   FHEcontext const& context) {
     check_auxiliary(ctx_a.getPubKey()); //sanity check
-    NTL::ZZX Xb = prepare_Xb(b, args, context);
+    NTL::ZZX Xb = threshold_poly(b, args, context);
 
     Ctxt result(ctx_a);
     result.multByConstant(Xb);
@@ -107,6 +119,45 @@ Ctxt greater_than(Ctxt const& ctx_a, long b,
     return result;
 }
 
+Ctxt greater_than(Ctxt const& ctx_a, EncodedPlaintext const& threshold,
+                  GreaterThanArgs const& args,
+                  FHEcontext const& context) {
+    check_auxiliary(ctx_a.getPubKey()); //sanity check
+    Ctxt result(ctx_a);
+    result.multByConstant(threshold.poly());
+
+    NTL::ZZX r;
+    if (args.randomized)
+        r = generate_random(context);
+    NTL::SetCoeff(r, 0, args.one_half); // Set the constant term 1/2
+    result.addConstant(r);
+    return result;
+}
+
+ThresholdCache::ThresholdCache(FHEcontext const& context) : context_(context) {}
+
+ThresholdCache::~ThresholdCache() {}
+
+EncodedPlaintext const& ThresholdCache::get(long b, GreaterThanArgs const& args) {
+    key_t key(b, args.mu0, args.mu1);
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        auto kv = encoded_.find(key);
+        if (kv != encoded_.end())
+            return kv->second;
+    }
+    /// Encode outside the lock; a racing thread may encode the same key, and the first one wins.
+    EncodedPlaintext encoded(threshold_poly(b, args, context_), context_);
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto kv = encoded_.insert(std::make_pair(key, encoded));
+    return kv.first->second;
+}
+
+size_t ThresholdCache::size() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return encoded_.size();
+}
+
 /// If greater then returns mu_0, else returns mu_1.
 Ctxt greater_than(Ctxt const& ctx_a, Ctxt const& ctx_b, FHEcontext const& context) {
     GreaterThanArgs args = create_greater_than_args(0L, 1L, context);
@@ -118,23 +169,16 @@ Ctxt greater_than(Ctxt const& ctx_a, long b, FHEcontext const& context) {
     return greater_than(ctx_a, b, args, context);
 }
 
+/// It used to be X^{a - b} * (test_v - 1) + (1 - X^{a - b} * test_v), where
+/// the two test vectors cancel out and leave 1 - X^{a - b}.
+/// The constant term is 0 iff a = b, since X^{a - b} has no constant term otherwise.
 Ctxt equality_test(Ctxt const& ctx_a, Ctxt const& ctx_b, FHEcontext const& context, bool rnd) {
     check_auxiliary(ctx_a.getPubKey()); //sanity check
-    NTL::ZZX test_v = create_test_v(context);
-    NTL::SetCoeff(test_v, 0, 0L);
-
-    Ctxt a_minus_b(ctx_b);
-    smart_negate_degree(&a_minus_b, context);
-    a_minus_b.multiplyBy(ctx_a); // X^{a - b}
-    
-    Ctxt helper(a_minus_b);
-    helper.multByConstant(test_v);
-    
-    auto gt_args = create_greater_than_args(2L, 0L, context);
-    a_minus_b.multByConstant((gt_args.mu1 - gt_args.one_half) * gt_args.test_v);
-    a_minus_b.addConstant(NTL::to_ZZ(gt_args.one_half));
-    
-    helper += a_minus_b;
+    Ctxt helper(ctx_b);
+    smart_negate_degree(&helper, context);
+    helper.multiplyBy(ctx_a); // X^{a - b}
+    helper.negate();
+    helper.addConstant(NTL::to_ZZ(1L));
     if (rnd) {
         NTL::ZZX r = generate_random(context);
         NTL::SetCoeff(r, 0, 0L); // Set the constant term as zero
@@ -188,6 +232,66 @@ Ctxt encrypt_in_degree(long val, FHESecKey const& key) {
     key.Encrypt(cipher, poly);
     return cipher;
 }
+double fresh_noise_var(FHESecKey const& key) {
+    Ctxt ctx(key);
+    key.Encrypt(ctx, NTL::ZZX());
+    return NTL::conv<double>(ctx.getNoiseVar());
+}
+
+/// The bits of the seeds, as the seeds of SymRLWE's Cipher.
+static const long SEED_BITS = 256;
+
+void encrypt_in_degree(SeededCtxt &ctx, long val, FHESecKey const& key, double noise_var) {
+    FHEcontext const& context = key.getContext();
+    NTL::ZZX poly;
+    encodeOnDegree(&poly, val, context);
+    NTL::RandomBits(ctx.seed, SEED_BITS);
+    DoubleCRT b(context, context.ctxtPrimes);
+    sampleUniform(&b, ctx.seed);
+    /// a = p * e - s * b + m, as RLWE() of HElib
+    ctx.a = std::make_shared<DoubleCRT>(context, context.ctxtPrimes);
+    ctx.a->sampleGaussian();
+    (*ctx.a) *= context.alMod.getPPowR();
+    b.Mul(key.sKeys.at(0), /*matchIndexSets = */false);
+    (*ctx.a) -= b;
+    (*ctx.a) += poly;
+    ctx.noise_var = noise_var;
+}
+
+bool expand_seeded(Ctxt &ctxt, SeededCtxt const& seeded) {
+    /// noise_var comes from the peer, and HElib decides the modulus switchings from it.
+    if (!seeded.a || !std::isfinite(seeded.noise_var) || seeded.noise_var <= 0.)
+        return false;
+    FHEcontext const& context = ctxt.getContext();
+    /// fresh ciphertexts live at the ciphertext primes, see encrypt_in_degree()
+    if (!(seeded.a->getIndexSet() == context.ctxtPrimes))
+        return false;
+    /// the noise of a decryptable ciphertext is below half of its modulus
+    if (std::log(seeded.noise_var) / 2 >= context.logOfProduct(seeded.a->getIndexSet()) - std::log(2.))
+        return false;
+    DoubleCRT b(context, seeded.a->getIndexSet());
+    sampleUniform(&b, seeded.seed);
+    /// HElib has no public way to set the parts of a Ctxt, so lay them out in its binary
+    /// format, as Ctxt::write() does: the residues are copied, not formatted and parsed.
+    /// The handles [powerOfS powerOfX keyID] of the parts of a fresh ciphertext are
+    /// [0 1 0] and [1 1 0].
+    std::stringstream bin;
+    writeEyeCatcher(bin, BINIO_EYE_CTXT_BEGIN);
+    write_raw_int(bin, context.alMod.getPPowR());
+    write_raw_xdouble(bin, NTL::xdouble(seeded.noise_var));
+    seeded.a->getIndexSet().write(bin);
+    write_raw_int(bin, 2);
+    CtxtPart(*seeded.a, SKHandle(0, 1, 0)).write(bin);
+    CtxtPart(b, SKHandle(1, 1, 0)).write(bin);
+    writeEyeCatcher(bin, BINIO_EYE_CTXT_END);
+    try {
+        ctxt.read(bin);
+    } catch (std::exception const&) {
+        return false;
+    }
+    return static_cast<bool>(bin);
+}
+
 /// F(X^a) --> F(X^{-a}) then apply the keyswtiching.
 void smart_negate_degree(Ctxt *ctx, FHEcontext const& context) {
     if (!ctx)
@@ -196,20 +300,379 @@ void smart_negate_degree(Ctxt *ctx, FHEcontext const& context) {
     ctx->smartAutomorph(M - 1);
 }
 
+long batch_lanes(long domain, FHEcontext const& context) {
+    const long N = context.zMStar.getPhiM();
+    /// only works for X^N + 1 ring
+    assert(context.zMStar.getM() == (N << 1));
+    assert(domain > 0 && domain <= N && N % domain == 0 && "The domain should divide N.");
+    return N / domain;
+}
+
+static NTL::ZZX encode_batch(std::vector<long> const& values, long domain, FHEcontext const& context) {
+    const long lanes = batch_lanes(domain, context);
+    assert(static_cast<long>(values.size()) <= lanes && "Too many values for the lanes.");
+    NTL::ZZX poly;
+    for (long j = 0; j < static_cast<long>(values.size()); j++) {
+        assert(values[j] >= 0 && values[j] < domain);
+        NTL::SetCoeff(poly, j + lanes * values[j]);
+    }
+    return poly;
+}
+
+void encrypt_batch(Ctxt &ctx, std::vector<long> const& values, long domain, FHEPubKey const& key) {
+    key.Encrypt(ctx, encode_batch(values, domain, key.getContext()));
+}
+
+void encrypt_batch(Ctxt &ctx, std::vector<long> const& values, long domain, FHESecKey const& key) {
+    key.Encrypt(ctx, encode_batch(values, domain, key.getContext()));
+}
+
+NTL::ZZX batch_threshold_poly(long b, long domain,
+                              GreaterThanArgs const& args,
+                              FHEcontext const& context) {
+    const long lanes = batch_lanes(domain, context);
+    assert(b >= 0 && b < domain);
+    /// The same as threshold_poly() in the subring, then spread by Y = X^s.
+    util::CoeffBuffer T(domain, context.alMod.getPPowR());
+    T.fill(args.ngt() - args.one_half);
+    T.negate_suffix(domain - b);
+    NTL::ZZX small, poly;
+    T.to_ZZX(small);
+    for (long t = 0; t <= NTL::deg(small); t++)
+        NTL::SetCoeff(poly, t * lanes, small[t]);
+    return poly;
+}
+
+/// The one_half of all the lanes, and random values for the other coefficients.
+static NTL::ZZX batch_mask(long lanes, GreaterThanArgs const& args, FHEcontext const& context) {
+    NTL::ZZX r;
+    if (args.randomized)
+        r = generate_random(context);
+    for (long j = 0; j < lanes; j++)
+        NTL::SetCoeff(r, j, args.one_half);
+    return r;
+}
+
+Ctxt greater_than_batch(Ctxt const& ctx_a, long b, long domain,
+                        GreaterThanArgs const& args,
+                        FHEcontext const& context) {
+    Ctxt result(ctx_a);
+    result.multByConstant(batch_threshold_poly(b, domain, args, context));
+    result.addConstant(batch_mask(batch_lanes(domain, context), args, context));
+    return result;
+}
+
+Ctxt greater_than_batch(Ctxt const& ctx_a, Ctxt const& ctx_b, long domain,
+                        GreaterThanArgs const& args,
+                        FHEcontext const& context) {
+    check_auxiliary(ctx_a.getPubKey()); //sanity check
+    Ctxt b_copy(ctx_b);
+    smart_negate_degree(&b_copy, context); // Y^{-b}
+    b_copy.multiplyBy(ctx_a); // X^j * Y^{a_j - b} for all the lanes
+    b_copy.multByConstant(batch_threshold_poly(0, domain, args, context));
+    b_copy.addConstant(batch_mask(batch_lanes(domain, context), args, context));
+    return b_copy;
+}
+
+std::vector<long> decode_batch(NTL::ZZX const& poly, long count, FHEcontext const& context) {
+    const long ptxt_space = context.alMod.getPPowR();
+    std::vector<long> values(count);
+    for (long j = 0; j < count; j++)
+        values[j] = NTL::rem(NTL::coeff(poly, j), ptxt_space);
+    return values;
+}
+
+/// log2(N), the bits of one digit.
+static long digit_bits(FHEcontext const& context) {
+    const long N = context.zMStar.getPhiM();
+    /// only works for X^N + 1 ring
+    assert(context.zMStar.getM() == (N << 1));
+    long bits = 0;
+    while ((1L << (bits + 1)) <= N)
+        bits += 1;
+    return bits;
+}
+
+/// The widest values, i.e., uint64_t.
+static const long MAX_WIDE_BITS = sizeof(uint64_t) * 8;
+
+long wide_digits(long bits, FHEcontext const& context) {
+    if (bits <= 0 || bits > MAX_WIDE_BITS)
+        return 0;
+    const long per_digit = digit_bits(context);
+    if (per_digit <= 0)
+        return 0;
+    return (bits + per_digit - 1) / per_digit;
+}
+
+/// The count digits of value, each one in [0, N). Empty if value does not fit in them.
+static std::vector<long> wide_to_digits(uint64_t value, long count, FHEcontext const& context) {
+    const long per_digit = digit_bits(context);
+    if (count <= 0 || per_digit <= 0 || per_digit >= MAX_WIDE_BITS)
+        return {};
+    const uint64_t mask = (1UL << per_digit) - 1;
+    std::vector<long> digits(count);
+    for (auto &digit : digits) {
+        digit = static_cast<long>(value & mask);
+        value >>= per_digit;
+    }
+    if (value != 0)
+        return {};
+    return digits;
+}
+
+/// Empty if bits is out of range or value does not fit in bits bits.
+static std::vector<long> wide_value_digits(uint64_t value, long bits, FHEcontext const& context) {
+    if (bits <= 0 || bits > MAX_WIDE_BITS)
+        return {};
+    if (bits < MAX_WIDE_BITS && (value >> bits) != 0)
+        return {};
+    return wide_to_digits(value, wide_digits(bits, context), context);
+}
+
+std::vector<Ctxt> encrypt_wide(uint64_t value, long bits, FHEPubKey const& key) {
+    std::vector<Ctxt> ctxts;
+    for (long digit : wide_value_digits(value, bits, key.getContext()))
+        ctxts.emplace_back(encrypt_in_degree(digit, key));
+    return ctxts;
+}
+
+std::vector<Ctxt> encrypt_wide(uint64_t value, long bits, FHESecKey const& key) {
+    std::vector<Ctxt> ctxts;
+    for (long digit : wide_value_digits(value, bits, key.getContext()))
+        ctxts.emplace_back(encrypt_in_degree(digit, key));
+    return ctxts;
+}
+
+/// The field trace, which keeps N times the constant term, then times N^{-1} mod p^r.
+/// The other coefficients become zeros, so products of the results multiply the constant terms.
+static void keep_constant_term(Ctxt &ct, FHEcontext const& context) {
+    const long N = context.zMStar.getPhiM();
+    const long ptxt_space = context.alMod.getPPowR();
+    for (long k = 2; k <= N; k <<= 1) {
+        Ctxt tmp(ct);
+        tmp.smartAutomorph(k + 1);
+        ct.addCtxt(tmp);
+    }
+    ct.multByConstant(NTL::to_ZZ(NTL::InvMod(N % ptxt_space, ptxt_space)));
+}
+
+/// Combine the per-digit bits gt_i = [a_i > b_i] and eq_i = [a_i = b_i], least significant
+/// first, into [a > b]. Adjacent digits are merged as (gt_hi + eq_hi * gt_lo, eq_hi * eq_lo),
+/// which takes ceil(log2(digits)) levels of multiplications.
+/// Then map the bit to mu0 if a > b, otherwise mu1.
+static Ctxt wide_combine(std::vector<std::unique_ptr<Ctxt>> &gt,
+                         std::vector<std::unique_ptr<Ctxt>> &eq,
+                         GreaterThanArgs const& args, FHEcontext const& context) {
+    while (gt.size() > 1) {
+        const long pairs = gt.size() >> 1;
+        const bool top = gt.size() == 2; // the equality of the whole value is not needed
+#pragma omp parallel for
+        for (long j = 0; j < pairs; j++) {
+            Ctxt carry(*gt[2 * j]);
+            carry.multiplyBy(*eq[2 * j + 1]);
+            gt[2 * j + 1]->addCtxt(carry);
+            if (!top)
+                eq[2 * j + 1]->multiplyBy(*eq[2 * j]);
+        }
+        std::vector<std::unique_ptr<Ctxt>> next_gt, next_eq;
+        for (size_t i = 1; i < gt.size(); i += 2) {
+            next_gt.push_back(std::move(gt[i]));
+            next_eq.push_back(std::move(eq[i]));
+        }
+        if (gt.size() & 1) {
+            next_gt.push_back(std::move(gt.back()));
+            next_eq.push_back(std::move(eq.back()));
+        }
+        gt.swap(next_gt);
+        eq.swap(next_eq);
+    }
+    Ctxt result(*gt[0]);
+    result.multByConstant(NTL::to_ZZ(args.gt() - args.ngt()));
+    NTL::ZZX r;
+    if (args.randomized)
+        r = generate_random(context);
+    NTL::SetCoeff(r, 0, args.ngt());
+    result.addConstant(r);
+    return result;
+}
+
+Ctxt greater_than_wide(std::vector<Ctxt> const& ctx_a, std::vector<Ctxt> const& ctx_b,
+                       GreaterThanArgs const& args, FHEcontext const& context) {
+    assert(!ctx_a.empty() && ctx_a.size() == ctx_b.size());
+    check_auxiliary(ctx_a.front().getPubKey()); //sanity check
+    assert(can_pack_constants(ctx_a.front().getPubKey()) && "Call setup_auxiliary_for_packing.");
+    const long digits = ctx_a.size();
+    GreaterThanArgs bit_args = create_greater_than_args(1L, 0L, context);
+    bit_args.randomized = args.randomized;
+    const EncodedPlaintext test_v = encode_test_v(bit_args, context);
+    std::vector<std::unique_ptr<Ctxt>> gt(digits), eq(digits);
+#pragma omp parallel for
+    for (long i = 0; i < digits; i++) {
+        gt[i].reset(new Ctxt(greater_than(ctx_a[i], ctx_b[i], bit_args, test_v, context)));
+        keep_constant_term(*gt[i], context);
+        /// 1 - equality_test() = X^{a_i - b_i} in the constant term
+        eq[i].reset(new Ctxt(equality_test(ctx_a[i], ctx_b[i], context, args.randomized)));
+        eq[i]->negate();
+        eq[i]->addConstant(NTL::to_ZZ(1L));
+        keep_constant_term(*eq[i], context);
+    }
+    return wide_combine(gt, eq, args, context);
+}
+
+Ctxt greater_than_wide(std::vector<Ctxt> const& ctx_a, uint64_t b,
+                       GreaterThanArgs const& args, FHEcontext const& context) {
+    assert(!ctx_a.empty());
+    assert(can_pack_constants(ctx_a.front().getPubKey()) && "Call setup_auxiliary_for_packing.");
+    const long N = context.zMStar.getPhiM();
+    const long digits = ctx_a.size();
+    auto b_digits = wide_to_digits(b, digits, context);
+    if (b_digits.empty()) {
+        /// b is beyond every value of the digits, so a > b is false.
+        Ctxt result(ctx_a.front().getPubKey());
+        NTL::ZZX r;
+        if (args.randomized)
+            r = generate_random(context);
+        NTL::SetCoeff(r, 0, args.ngt());
+        result.addConstant(r);
+        return result;
+    }
+    GreaterThanArgs bit_args = create_greater_than_args(1L, 0L, context);
+    bit_args.randomized = args.randomized;
+    std::vector<std::unique_ptr<Ctxt>> gt(digits), eq(digits);
+#pragma omp parallel for
+    for (long i = 0; i < digits; i++) {
+        gt[i].reset(new Ctxt(greater_than(ctx_a[i], b_digits[i], bit_args, context)));
+        keep_constant_term(*gt[i], context);
+        /// X^{a_i} * X^{-b_i}, where X^{-b} = -X^{N - b} for b > 0
+        NTL::ZZX monomial;
+        NTL::SetCoeff(monomial, b_digits[i] == 0 ? 0 : N - b_digits[i], b_digits[i] == 0 ? 1 : -1);
+        eq[i].reset(new Ctxt(ctx_a[i]));
+        eq[i]->multByConstant(monomial);
+        keep_constant_term(*eq[i], context);
+    }
+    return wide_combine(gt, eq, args, context);
+}
+
+void setup_auxiliary_for_packing(FHESecKey *sk) {
+    if (!sk)
+        return;
+    const long N = sk->getContext().zMStar.getPhiM();
+    for (long k = 2; k <= N; k <<= 1)
+        sk->GenKeySWmatrix(1, k + 1, 0, 0);
+    sk->setKeySwitchMap();
+}
+
+bool can_pack_constants(FHEPubKey const& pk) {
+    const long N = pk.getContext().zMStar.getPhiM();
+    for (long k = 2; k <= N; k <<= 1) {
+        if (!pk.haveKeySWmatrix(1, k + 1, 0, 0))
+            return false;
+    }
+    return true;
+}
+
+/// ct_even + X^shift * ct_odd + tau_{2^l + 1}(ct_even - X^shift * ct_odd)
+static std::unique_ptr<Ctxt> combine_packed(Ctxt const* even, Ctxt const* odd,
+                                            EncodedPlaintext const& monomial, long k) {
+    if (!even && !odd)
+        return nullptr;
+    std::unique_ptr<Ctxt> sum, diff;
+    if (even) {
+        sum.reset(new Ctxt(*even));
+        diff.reset(new Ctxt(*even));
+    }
+    if (odd) {
+        Ctxt shifted(*odd);
+        shifted.multByConstant(monomial.poly());
+        if (sum) {
+            sum->addCtxt(shifted);
+            diff->addCtxt(shifted, /*negative = */true);
+        } else {
+            sum.reset(new Ctxt(shifted));
+            shifted.negate();
+            diff.reset(new Ctxt(shifted));
+        }
+    }
+    diff->smartAutomorph(k);
+    sum->addCtxt(*diff);
+    return sum;
+}
+
+Ctxt pack_constants(std::vector<const Ctxt *> const& cts, FHEPubKey const& pk) {
+    FHEcontext const& context = pk.getContext();
+    const long N = context.zMStar.getPhiM();
+    const long n = cts.size();
+    assert(n > 0 && n <= N && (n & (n - 1)) == 0 && "The number of ciphertexts should be a power of two.");
+    assert(can_pack_constants(pk) && "Call setup_auxiliary_for_packing.");
+
+    /// At the l-th level, combine the i-th and the (i + n / 2^l)-th ones.
+    std::vector<std::unique_ptr<Ctxt>> packed;
+    std::vector<const Ctxt *> current(cts);
+    long log_n = 0;
+    for (long half = n >> 1; half > 0; half >>= 1) {
+        log_n += 1;
+        NTL::ZZX monomial;
+        NTL::SetCoeff(monomial, N >> log_n);
+        EncodedPlaintext encoded(monomial, context);
+        std::vector<std::unique_ptr<Ctxt>> next(half);
+#pragma omp parallel for
+        for (long i = 0; i < half; i++)
+            next[i] = combine_packed(current[i], current[i + half], encoded, (1L << log_n) + 1);
+        packed.swap(next);
+        current.resize(half);
+        for (long i = 0; i < half; i++)
+            current[i] = packed[i].get();
+    }
+
+    Ctxt result(pk);
+    if (current[0])
+        result = *current[0];
+    /// The field trace kills the coefficients that are not multiples of N / n.
+    for (long k = 2L << log_n; k <= N; k <<= 1) {
+        Ctxt tmp(result);
+        tmp.smartAutomorph(k + 1);
+        result.addCtxt(tmp);
+    }
+    return result;
+}
+
+std::vector<long> unpack_constants(NTL::ZZX const& poly, long n, FHEcontext const& context) {
+    const long N = context.zMStar.getPhiM();
+    const long ptxt_space = context.alMod.getPPowR();
+    if (n <= 0 || n > N || (n & (n - 1)) != 0)
+        return {};
+    const long inv_N = NTL::InvMod(N % ptxt_space, ptxt_space);
+    std::vector<long> values(n);
+    for (long i = 0; i < n; i++) {
+        long v = NTL::rem(NTL::coeff(poly, i * (N / n)), ptxt_space);
+        values[i] = NTL::MulMod(v, inv_N, ptxt_space);
+    }
+    return values;
+}
+
+Ctxt count_less_than(Ctxt const& ctx_a, 
+                     std::vector<Ctxt> const& ctx_b_vec, 
+                     FHEcontext const& context) {
+    GreaterThanArgs gt_args = create_greater_than_args(1, 0, context);
+    return count_less_than(ctx_a, ctx_b_vec, encode_test_v(gt_args, context), context);
+}
+
 Ctxt count_less_than(Ctxt const& ctx_a, 
                      std::vector<Ctxt> const& ctx_b_vec, 
+                     EncodedPlaintext const& test_v,
                      FHEcontext const& context) {
     Ctxt sum_b(ctx_a.getPubKey());
     for (auto const& b : ctx_b_vec)
         sum_b += b;
     /// [X^b] --> [X^-b]
     smart_negate_degree(&sum_b, context);
-    /// return 1 for greater, o.w. return 0
-    GreaterThanArgs gt_args = create_greater_than_args(1, 0, context);
+    /// return 1 for greater, o.w. return 0, i.e., one_half = 1/2
+    const long ptxt_space = context.alMod.getPPowR();
+    const long one_half = NTL::InvMod(2L, ptxt_space);
     sum_b.multiplyBy(ctx_a);
-    NTL::ZZX T = (gt_args.mu1 - gt_args.one_half) * gt_args.test_v;
-    sum_b.multByConstant(T);
-    long n = ctx_b_vec.size() * gt_args.one_half;
+    sum_b.multByConstant(test_v.poly());
+    long n = ctx_b_vec.size() * one_half;
     sum_b.addConstant(NTL::to_ZZ(n));
     return sum_b;
 }
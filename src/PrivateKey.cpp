@@ -5,13 +5,16 @@
 #include <HElib/DoubleCRT.h>
 #include <HElib/FHE.h>
 #include <NTL/ZZX.h>
-PrivateKey::PrivateKey(const FHEcontext &context) : context(context) {
+static const long SEED_BITS = 256;
+
+PrivateKey::PrivateKey(const FHEcontext &context)
+    : context(context), pool(PolynomialPool::create(context)) {
     private_s = std::make_shared<Polynomial>(context);
     private_s->sampleHWt(64);
     ptxtSpace = context.alMod.getPPowR();
 }
 
-PrivateKey::PrivateKey(const PrivateKey &oth) : context(oth.context) {
+PrivateKey::PrivateKey(const PrivateKey &oth) : context(oth.context), pool(oth.pool) {
     private_s = copy_ptr(oth.private_s);
     ptxtSpace = oth.ptxtSpace;
 }
@@ -22,6 +25,10 @@ const FHEcontext& PrivateKey::getContext() const {
     return context;
 }
 
+std::shared_ptr<PolynomialPool> PrivateKey::getPool() const {
+    return pool;
+}
+
 void PrivateKey::power(long k) {
     private_s->automorph(k);
 }
@@ -37,23 +44,37 @@ void PrivateKey::EncryptOnDegree(Cipher *cipher, long degree) const {
 void PrivateKey::Encrypt(Cipher *cipher, const NTL::ZZX &message) const {
     if (!cipher)
         return;
-    auto a = std::make_shared<DoubleCRT>(context);
-    auto b = std::make_shared<DoubleCRT>(context);
-    RLWE(*a, *b, *private_s, NTL::to_long(ptxtSpace));
+    /// Same as RLWE(), but b is expanded from a seed so that the cipher can be compressed.
+    auto seed = std::make_shared<NTL::ZZ>();
+    NTL::RandomBits(*seed, SEED_BITS);
+    auto a = pool->acquire();
+    auto b = pool->acquire();
+    sampleUniform(b.get(), *seed);
+    a->sampleGaussian();
+    (*a) *= ptxtSpace;
+    auto sb = pool->acquire(*b);
+    (*sb) *= (*private_s);
+    (*a) -= (*sb);
     (*a) += message;
     /// a + message + s*b = p*e + message
-    cipher->set_cipher(a, b); 
+    cipher->set_cipher(a, b, seed); 
 }
 
 void PrivateKey::Decrypt(NTL::ZZX *message, const Cipher &cipher) const {
     if (!message)
         return;
     /// s*b + a \mod p = message
-    DoubleCRT b(*cipher.get_b()); 
-    b *= (*private_s);
-    b += (*cipher.get_a());
+    Polynomial_ptr b;
+    if (cipher.get_b()) {
+        b = copy_ptr(cipher.get_b());
+    } else {
+        b = pool->acquire();
+        sampleUniform(b.get(), *cipher.get_seed());
+    }
+    (*b) *= (*private_s);
+    (*b) += (*cipher.get_a());
 
-    b.toPoly(*message);
+    b->toPoly(*message);
     PolyRed(*message, ptxtSpace, false/*reduce to [-p/2,p/2]*/);
     //PolyRed(*message, ptxtSpace, true/*reduce to [0, p)*/);
 }
@@ -70,3 +91,11 @@ void encodeOnDegree(NTL::ZZX *poly, long degree, const FHEcontext &context) {
     NTL::SetCoeff(*poly, degree, 1);
 }
 
+
+void sampleUniform(Polynomial *poly, const NTL::ZZ &seed) {
+    if (!poly)
+        return;
+    /// Keep the random stream of the calling thread untouched.
+    NTL::RandomStreamPush push;
+    poly->randomize(&seed);
+}
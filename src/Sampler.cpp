@@ -0,0 +1,79 @@
+#include "util/Sampler.hpp"
+#include <NTL/ZZX.h>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+namespace util {
+void derive_key(unsigned char *out, const unsigned char *key, std::initializer_list<long> tags) {
+    std::vector<unsigned char> data(NTL_PRG_KEYLEN + tags.size() * sizeof(long));
+    std::memcpy(data.data(), key, NTL_PRG_KEYLEN);
+    unsigned char *pos = data.data() + NTL_PRG_KEYLEN;
+    for (long tag : tags) {
+        std::memcpy(pos, &tag, sizeof tag);
+        pos += sizeof tag;
+    }
+    NTL::DeriveKey(out, NTL_PRG_KEYLEN, data.data(), data.size());
+}
+
+Sampler::Sampler() {
+    unsigned char key[NTL_PRG_KEYLEN];
+    NTL::GetCurrentRandomStream().get(key, NTL_PRG_KEYLEN);
+    stream_.reset(new NTL::RandomStream(key));
+}
+
+Sampler::Sampler(const unsigned char *key, std::initializer_list<long> tags) {
+    reseed(key, tags);
+}
+
+Sampler::~Sampler() {}
+
+Sampler& Sampler::local() {
+    thread_local Sampler sampler;
+    return sampler;
+}
+
+void Sampler::reseed(const unsigned char *key, std::initializer_list<long> tags) {
+    unsigned char derived[NTL_PRG_KEYLEN];
+    derive_key(derived, key, tags);
+    stream_.reset(new NTL::RandomStream(derived));
+}
+
+static inline uint64_t to_word(const unsigned char *p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof v);
+    return v;
+}
+
+/// The bias of a 64-bit word modulo p < 2^62 is negligible.
+long Sampler::uniform(long p) {
+    unsigned char buf[sizeof(uint64_t)];
+    stream_->get(buf, sizeof buf);
+    return static_cast<long>(to_word(buf) % static_cast<uint64_t>(p));
+}
+
+long Sampler::non_zero(long p) {
+    long ret = 0;
+    do {
+        ret = uniform(p);
+    } while (ret == 0);
+    return ret;
+}
+
+void Sampler::uniform_poly(NTL::ZZX &poly, long n, long p, long from) {
+    if (n <= 0) {
+        NTL::clear(poly);
+        return;
+    }
+    from = std::max(0L, std::min(from, n));
+    buf_.resize((n - from) * sizeof(uint64_t));
+    stream_->get(buf_.data(), buf_.size());
+    poly.rep.SetLength(n);
+    for (long i = 0; i < from; i++)
+        poly.rep[i] = 0;
+    const unsigned char *pos = buf_.data();
+    for (long i = from; i < n; i++, pos += sizeof(uint64_t))
+        poly.rep[i] = static_cast<long>(to_word(pos) % static_cast<uint64_t>(p));
+    poly.normalize();
+}
+} // namespace util
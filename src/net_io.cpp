@@ -1,6 +1,16 @@
 #include "network/net_io.hpp"
+#include "util/BlockingQueue.hpp"
+#include "util/Timer.hpp"
 #include <HElib/FHEContext.h>
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <poll.h>
+
 FHEcontext receive_context(std::istream &s) {
     unsigned long m, p, r;
     std::vector<long> gens, ords;
@@ -33,6 +43,116 @@ int run_server(routine_t server_routine) {
     return 0;
 }
 
+void ServerStats::record(uint64_t queue, uint64_t service) {
+    sessions.fetch_add(1);
+    queue_ns.fetch_add(queue);
+    service_ns.fetch_add(service);
+    uint64_t seen = max_service_ns.load();
+    while (seen < service && !max_service_ns.compare_exchange_weak(seen, service)) {}
+}
+
+void ServerStats::report(std::ostream &os) const {
+    uint64_t n = sessions.load();
+    double avg_queue = n > 0 ? queue_ns.load() / 1.0e6 / n : 0.;
+    double avg_service = n > 0 ? service_ns.load() / 1.0e6 / n : 0.;
+    os << "SESSIONS IN_FLIGHT AVG_QUEUE_MS AVG_SERVICE_MS MAX_SERVICE_MS\n"
+       << n << " " << in_flight.load() << " " << avg_queue << " "
+       << avg_service << " " << max_service_ns.load() / 1.0e6 << std::endl;
+}
+
+namespace {
+struct PendingSession {
+    std::unique_ptr<tcp::iostream> conn;
+    Clock::time_point accepted;
+};
+
+/// How often the accept loop checks the stop flag while there is no client.
+const int STOP_POLL_MS = 100;
+
+/// Wait up to STOP_POLL_MS for a pending connection. Return false on timeout.
+bool wait_for_client(tcp::acceptor &acceptor) {
+    pollfd pfd;
+    pfd.fd = acceptor.native_handle();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return ::poll(&pfd, 1, STOP_POLL_MS) > 0;
+}
+}
+
+int run_server(routine_t server_routine, ServerOptions const& opts, ServerStats *stats) {
+    boost::asio::io_service ios;
+    tcp::endpoint endpoint(tcp::v4(), network::port);
+    tcp::acceptor acceptor(ios, endpoint);
+    util::BlockingQueue<PendingSession> queue(opts.queue_depth);
+
+    auto worker = [&]() {
+        PendingSession session;
+        while (queue.pop(session)) {
+            auto start = Clock::now();
+            if (stats)
+                stats->in_flight.fetch_add(1);
+            if (opts.session_timeout.count() > 0)
+                session.conn->expires_after(opts.session_timeout);
+            /// A failing session must not take the worker, and the server, down with it.
+            try {
+                server_routine(*session.conn);
+            } catch (std::exception const& e) {
+                std::cerr << "Session aborted: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "Session aborted" << std::endl;
+            }
+            session.conn->close();
+            auto end = Clock::now();
+            if (stats) {
+                stats->in_flight.fetch_sub(1);
+                stats->record(duration_cast<Time_t>(start - session.accepted).count(),
+                              duration_cast<Time_t>(end - start).count());
+            }
+            session.conn.reset();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < std::max<size_t>(1, opts.workers); i++)
+        workers.emplace_back(worker);
+
+    /// The acceptor does not block, so the loop sees the stop flag between clients.
+    acceptor.non_blocking(true);
+    auto stopping = [&opts]() { return opts.stop && opts.stop->load(); };
+    /// Back off on accept errors, which tend to persist (e.g., EMFILE), instead of spinning.
+    const std::chrono::milliseconds min_backoff(10), max_backoff(1000);
+    std::chrono::milliseconds backoff = min_backoff;
+    for (long served = 0; (opts.max_sessions < 0 || served < opts.max_sessions) && !stopping(); ) {
+        if (!wait_for_client(acceptor))
+            continue;
+        PendingSession session;
+        session.conn.reset(new tcp::iostream());
+        boost::system::error_code err;
+        acceptor.accept(*session.conn->rdbuf(), err);
+        if (err == boost::asio::error::would_block || err == boost::asio::error::try_again)
+            continue; // the client is gone before accepted
+        if (err) {
+            std::cerr << "Accept failed: " << err.message() << std::endl;
+            std::this_thread::sleep_for(backoff);
+            backoff = std::min(backoff * 2, max_backoff);
+            continue;
+        }
+        backoff = min_backoff;
+        session.accepted = Clock::now();
+        if (!queue.push(std::move(session)))
+            break;
+        served += 1;
+    }
+
+    /// Refuse the new clients instead of leaving them in the kernel backlog.
+    boost::system::error_code ignored;
+    acceptor.close(ignored);
+    queue.close();
+    for (auto &w : workers)
+        w.join();
+    return 0;
+}
+
 int run_client(routine_t client_routine) {
     tcp::iostream conn(network::addr, std::to_string(network::port));
     if (!conn) {
@@ -1,5 +1,91 @@
 #include "SymRLWE/types.hpp"
 #include "HElib/DoubleCRT.h" 
+
 Polynomial_ptr copy_ptr(const Polynomial_ptr a) {
+    if (auto pool = PolynomialPool::owner(a))
+        return pool->acquire(*a);
     return std::make_shared<Polynomial>(*a);
 }
+
+Polynomial_ptr new_ptr(const Polynomial_ptr a) {
+    if (auto pool = PolynomialPool::owner(a))
+        return pool->acquire();
+    return std::make_shared<Polynomial>(a->getContext());
+}
+
+namespace {
+const size_t DEFAULT_CAPACITY = 64;
+} // namespace
+
+std::shared_ptr<PolynomialPool> PolynomialPool::create(const FHEcontext &context) {
+    return std::shared_ptr<PolynomialPool>(new PolynomialPool(context));
+}
+
+std::shared_ptr<PolynomialPool> PolynomialPool::owner(const Polynomial_ptr &poly) {
+    const Deleter *deleter = std::get_deleter<Deleter>(poly);
+    return deleter ? deleter->pool.lock() : nullptr;
+}
+
+void PolynomialPool::Deleter::operator()(Polynomial *poly) const {
+    if (auto alive = pool.lock())
+        alive->release(poly);
+    else
+        delete poly;
+}
+
+PolynomialPool::PolynomialPool(const FHEcontext &context)
+    : prototype_(new Polynomial(context)), capacity_(DEFAULT_CAPACITY) {}
+
+PolynomialPool::~PolynomialPool() {}
+
+Polynomial_ptr PolynomialPool::acquire() {
+    std::unique_ptr<Polynomial> poly;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        if (!idle_.empty()) {
+            poly = std::move(idle_.back());
+            idle_.pop_back();
+        }
+    }
+    if (!poly)
+        poly.reset(new Polynomial(*prototype_));
+    return Polynomial_ptr(poly.release(), Deleter{shared_from_this()});
+}
+
+Polynomial_ptr PolynomialPool::acquire(const Polynomial &poly) {
+    auto copy = acquire();
+    /// The residue tables are overwritten in place.
+    *copy = poly;
+    return copy;
+}
+
+void PolynomialPool::release(Polynomial *poly) {
+    std::unique_ptr<Polynomial> owned(poly);
+    /// Only the polynomials over all the primes are interchangeable.
+    if (!(owned->getIndexSet() == prototype_->getIndexSet()))
+        return;
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (idle_.size() < capacity_)
+        idle_.push_back(std::move(owned));
+}
+
+void PolynomialPool::set_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    capacity_ = capacity;
+    if (idle_.size() > capacity_)
+        idle_.resize(capacity_);
+}
+
+size_t PolynomialPool::idle() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return idle_.size();
+}
+
+EncodedPlaintext::EncodedPlaintext(const NTL::ZZX &poly, const FHEcontext &context)
+    : poly_(std::make_shared<const Polynomial>(poly, context, context.ctxtPrimes)) {
+}
+
+EncodedPlaintext::EncodedPlaintext(const NTL::ZZX &poly, const FHEcontext &context,
+                                   const IndexSet &primes)
+    : poly_(std::make_shared<const Polynomial>(poly, context, primes)) {
+}
@@ -0,0 +1,282 @@
+#include "network/wire.hpp"
+#include "PrivateGreaterThan/GreaterThan.hpp"
+#include <HElib/FHE.h>
+#include <HElib/FHEContext.h>
+#include <NTL/lzz_pX.h>
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <vector>
+
+namespace wire {
+namespace {
+const char MAGIC[4] = {'P', 'P', 'D', 'T'};
+const size_t HEADER_SIZE = 16;
+const size_t READ_CHUNK = 1 << 20;
+const size_t COUNT_SIZE = 8;
+const size_t NOISE_SIZE = 8;
+/// Ciphertexts on the wire have at most three parts, i.e., before relinearization.
+const uint64_t MAX_CTXT_PARTS = 3;
+/// Room for the eye-catchers, index sets and key handles around the residues.
+const uint64_t SERIALIZE_SLACK = 1024;
+/// The relinearization and the greater-than automorphism, see setup_auxiliary_for_greater_than().
+const uint64_t FIXED_KEY_SWITCH_MATRICES = 2;
+
+/// HElib's binary DoubleCRT: one word per coefficient and prime, plus the index set.
+uint64_t max_poly_bytes(FHEcontext const& context) {
+    const uint64_t primes = context.numPrimes();
+    const uint64_t phim = context.zMStar.getPhiM();
+    return sizeof(int64_t) * primes * (phim + 1) + SERIALIZE_SLACK;
+}
+
+void put_le(std::string &buf, uint64_t v, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++)
+        buf.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+}
+
+uint64_t get_le(const unsigned char *buf, size_t bytes) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < bytes; i++)
+        v |= static_cast<uint64_t>(buf[i]) << (8 * i);
+    return v;
+}
+} // namespace
+
+void write_frame(std::ostream &os, FrameType type, std::string const& payload) {
+    std::string frame;
+    frame.reserve(HEADER_SIZE + payload.size());
+    frame.append(MAGIC, sizeof MAGIC);
+    put_le(frame, VERSION, 2);
+    put_le(frame, static_cast<uint16_t>(type), 2);
+    put_le(frame, payload.size(), 8);
+    frame.append(payload);
+    os.write(frame.data(), frame.size());
+}
+
+uint64_t max_payload(FrameType type) {
+    switch (type) {
+    case FrameType::COUNT:
+        return COUNT_SIZE;
+    case FrameType::FINGERPRINT:
+        return FINGERPRINT_SIZE;
+    case FrameType::CONTEXT:
+        return MAX_CONTEXT_PAYLOAD;
+    default:
+        return MAX_PAYLOAD;
+    }
+}
+
+uint64_t max_ctxt_payload(FHEcontext const& context) {
+    return MAX_CTXT_PARTS * max_poly_bytes(context) + SERIALIZE_SLACK;
+}
+
+uint64_t max_pubkey_payload(FHEcontext const& context) {
+    /// the packing trace takes one matrix per X -> X^{k + 1}, k = 2, 4, ..., phi(m)
+    const uint64_t matrices = FIXED_KEY_SWITCH_MATRICES + NTL::NumBits(context.zMStar.getPhiM());
+    const uint64_t digits = std::max<uint64_t>(context.digits.size(), 1);
+    const uint64_t matrix_bytes = digits * max_poly_bytes(context) + SERIALIZE_SLACK;
+    return max_ctxt_payload(context) + matrices * matrix_bytes + SERIALIZE_SLACK;
+}
+
+bool read_frame(std::istream &is, FrameType expected, std::string &payload,
+                uint64_t max_length) {
+    unsigned char header[HEADER_SIZE];
+    if (!is.read(reinterpret_cast<char *>(header), HEADER_SIZE))
+        return false;
+    if (!std::equal(MAGIC, MAGIC + sizeof MAGIC, reinterpret_cast<char *>(header))) {
+        std::cerr << "wire: bad magic\n";
+        return false;
+    }
+    uint16_t version = static_cast<uint16_t>(get_le(header + 4, 2));
+    if (version != VERSION) {
+        std::cerr << "wire: unsupported version " << version << "\n";
+        return false;
+    }
+    uint16_t type = static_cast<uint16_t>(get_le(header + 6, 2));
+    if (type != static_cast<uint16_t>(expected)) {
+        std::cerr << "wire: expect frame " << static_cast<uint16_t>(expected)
+                  << " but got " << type << "\n";
+        return false;
+    }
+    uint64_t length = get_le(header + 8, 8);
+    if (length > std::min(max_length, max_payload(expected))) {
+        std::cerr << "wire: frame too large " << length << "\n";
+        return false;
+    }
+    /// Grow with the bytes that actually arrive, not with the claimed length.
+    payload.clear();
+    payload.reserve(std::min<uint64_t>(length, READ_CHUNK));
+    while (payload.size() < length) {
+        size_t done = payload.size();
+        size_t n = static_cast<size_t>(std::min<uint64_t>(length - done, READ_CHUNK));
+        payload.resize(done + n);
+        if (!is.read(&payload[done], n))
+            return false;
+    }
+    return true;
+}
+
+void send_count(std::ostream &os, int64_t count) {
+    std::string payload;
+    put_le(payload, static_cast<uint64_t>(count), COUNT_SIZE);
+    write_frame(os, FrameType::COUNT, payload);
+}
+
+bool receive_count(std::istream &is, int64_t &count) {
+    std::string payload;
+    if (!read_frame(is, FrameType::COUNT, payload) || payload.size() != COUNT_SIZE)
+        return false;
+    count = static_cast<int64_t>(get_le(reinterpret_cast<const unsigned char *>(payload.data()), COUNT_SIZE));
+    return true;
+}
+
+void send_ctxt(std::ostream &os, Ctxt const& ctxt) {
+    std::ostringstream buf;
+    ctxt.write(buf);
+    write_frame(os, FrameType::CTXT, buf.str());
+}
+
+bool receive_ctxt(std::istream &is, Ctxt &ctxt) {
+    std::string payload;
+    if (!read_frame(is, FrameType::CTXT, payload, max_ctxt_payload(ctxt.getContext())))
+        return false;
+    std::istringstream buf(payload);
+    try {
+        ctxt.read(buf);
+    } catch (std::exception const& e) {
+        std::cerr << "wire: bad ciphertext " << e.what() << "\n";
+        return false;
+    }
+    return static_cast<bool>(buf);
+}
+
+void send_seeded_ctxt(std::ostream &os, SeededCtxt const& ctxt) {
+    std::string payload(SEED_SIZE, '\0');
+    NTL::BytesFromZZ(reinterpret_cast<unsigned char *>(&payload[0]), ctxt.seed, SEED_SIZE);
+    uint64_t noise_bits;
+    std::memcpy(&noise_bits, &ctxt.noise_var, sizeof noise_bits);
+    put_le(payload, noise_bits, NOISE_SIZE);
+    std::ostringstream buf;
+    ctxt.a->write(buf);
+    payload.append(buf.str());
+    write_frame(os, FrameType::SEEDED_CTXT, payload);
+}
+
+bool receive_seeded_ctxt(std::istream &is, Ctxt &ctxt) {
+    std::string payload;
+    const uint64_t max_length = SEED_SIZE + NOISE_SIZE + max_poly_bytes(ctxt.getContext());
+    if (!read_frame(is, FrameType::SEEDED_CTXT, payload, max_length)
+        || payload.size() < SEED_SIZE + NOISE_SIZE)
+        return false;
+    auto bytes = reinterpret_cast<const unsigned char *>(payload.data());
+    SeededCtxt seeded;
+    NTL::ZZFromBytes(seeded.seed, bytes, SEED_SIZE);
+    uint64_t noise_bits = get_le(bytes + SEED_SIZE, NOISE_SIZE);
+    std::memcpy(&seeded.noise_var, &noise_bits, sizeof noise_bits);
+    std::istringstream buf(payload.substr(SEED_SIZE + NOISE_SIZE));
+    try {
+        seeded.a = std::make_shared<DoubleCRT>(ctxt.getContext());
+        seeded.a->read(buf);
+        if (!buf)
+            return false;
+        return expand_seeded(ctxt, seeded);
+    } catch (std::exception const& e) {
+        std::cerr << "wire: bad seeded ciphertext " << e.what() << "\n";
+        return false;
+    }
+}
+
+std::string serialize_pubkey(FHEPubKey const& pk) {
+    std::ostringstream buf;
+    writePubKeyBinary(buf, pk);
+    return buf.str();
+}
+
+bool parse_pubkey(std::string const& payload, FHEPubKey &pk) {
+    std::istringstream buf(payload);
+    try {
+        readPubKeyBinary(buf, pk);
+    } catch (std::exception const& e) {
+        std::cerr << "wire: bad public key " << e.what() << "\n";
+        return false;
+    }
+    return static_cast<bool>(buf);
+}
+
+void send_pubkey(std::ostream &os, FHEPubKey const& pk) {
+    write_frame(os, FrameType::PUBKEY, serialize_pubkey(pk));
+}
+
+bool receive_pubkey(std::istream &is, FHEPubKey &pk) {
+    std::string payload;
+    if (!read_frame(is, FrameType::PUBKEY, payload, max_pubkey_payload(pk.getContext())))
+        return false;
+    return parse_pubkey(payload, pk);
+}
+
+std::string serialize_context(FHEcontext const& context) {
+    std::ostringstream buf;
+    writeContextBaseBinary(buf, context);
+    writeContextBinary(buf, context);
+    return buf.str();
+}
+
+std::unique_ptr<FHEcontext> parse_context(std::string const& payload) {
+    std::istringstream buf(payload);
+    unsigned long m, p, r;
+    std::vector<long> gens, ords;
+    readContextBaseBinary(buf, m, p, r, gens, ords);
+    if (!buf)
+        return nullptr;
+    /// the tables of the context grow with m
+    if (m > MAX_M) {
+        std::cerr << "wire: context too large, m = " << m << "\n";
+        return nullptr;
+    }
+    std::unique_ptr<FHEcontext> context;
+    try {
+        context.reset(new FHEcontext(m, p, r, gens, ords));
+        NTL::zz_p::init(p);
+        readContextBinary(buf, *context);
+    } catch (std::exception const& e) {
+        std::cerr << "wire: bad context " << e.what() << "\n";
+        return nullptr;
+    }
+    if (!buf)
+        return nullptr;
+    return context;
+}
+
+void send_context(std::ostream &os, FHEcontext const& context) {
+    write_frame(os, FrameType::CONTEXT, serialize_context(context));
+}
+
+std::unique_ptr<FHEcontext> receive_context(std::istream &is) {
+    std::string payload;
+    if (!read_frame(is, FrameType::CONTEXT, payload))
+        return nullptr;
+    return parse_context(payload);
+}
+
+std::string fingerprint(std::string const& context_payload, std::string const& pubkey_payload) {
+    std::string data;
+    /// length-prefix the context so that the boundary is fixed
+    put_le(data, context_payload.size(), 8);
+    data.append(context_payload);
+    data.append(pubkey_payload);
+    std::string fp(FINGERPRINT_SIZE, '\0');
+    NTL::DeriveKey(reinterpret_cast<unsigned char *>(&fp[0]), FINGERPRINT_SIZE,
+                   reinterpret_cast<const unsigned char *>(data.data()), data.size());
+    return fp;
+}
+
+void send_fingerprint(std::ostream &os, std::string const& fp) {
+    write_frame(os, FrameType::FINGERPRINT, fp);
+}
+
+bool receive_fingerprint(std::istream &is, std::string &fp) {
+    return read_frame(is, FrameType::FINGERPRINT, fp) && fp.size() == FINGERPRINT_SIZE;
+}
+} // namespace wire
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <NTL/ZZX.h>
+
+#include "util/CoeffBuffer.hpp"
+#include <vector>
+
+namespace {
+    const std::vector<util::SimdLevel> LEVELS = {util::SimdLevel::SCALAR,
+                                                 util::SimdLevel::AVX2,
+                                                 util::SimdLevel::AVX512};
+    const long N = 4096 + 3; // not a multiple of the vector width
+    const uint64_t Q = 1031;
+
+    util::CoeffBuffer random_buffer() {
+        util::CoeffBuffer buf(N, Q);
+        for (long i = 0; i < N; i++)
+            buf.data()[i] = NTL::RandomBnd(static_cast<long>(Q));
+        buf.data()[0] = 0;
+        return buf;
+    }
+
+    class CoeffBufferTest : public ::testing::Test {
+    protected:
+        void TearDown() override {
+            util::force_simd_level(util::detected_simd_level());
+        }
+    };
+
+    TEST_F(CoeffBufferTest, RotateAsMonomialProduct) {
+        util::CoeffBuffer buf = random_buffer();
+        for (auto level : LEVELS) {
+            util::force_simd_level(level);
+            for (long k : {0L, 1L, 17L, N - 1, N, N + 5, 2 * N - 1, -1L, -N - 3}) {
+                util::CoeffBuffer out(N, Q);
+                buf.rotate(out, k);
+                for (long i = 0; i < N; i++) {
+                    long j = ((i + k) % (2 * N) + 2 * N) % (2 * N);
+                    uint64_t v = buf.data()[i];
+                    if (j >= N) {
+                        j -= N;
+                        v = v == 0 ? 0 : Q - v;
+                    }
+                    ASSERT_EQ(v, out.data()[j]);
+                }
+            }
+        }
+    }
+
+    TEST_F(CoeffBufferTest, NegateSuffix) {
+        util::CoeffBuffer buf = random_buffer();
+        for (auto level : LEVELS) {
+            util::force_simd_level(level);
+            util::CoeffBuffer out(buf);
+            out.negate_suffix(N / 3);
+            for (long i = 0; i < N; i++) {
+                uint64_t v = buf.data()[i];
+                if (i >= N / 3)
+                    v = v == 0 ? 0 : Q - v;
+                ASSERT_EQ(v, out.data()[i]);
+            }
+        }
+    }
+
+    TEST_F(CoeffBufferTest, AddConstant) {
+        util::CoeffBuffer buf = random_buffer();
+        for (auto level : LEVELS) {
+            util::force_simd_level(level);
+            for (long c : {0L, 1L, 1030L, -1L, 5000L}) {
+                util::CoeffBuffer out(buf);
+                out.add_constant(c);
+                uint64_t rc = ((c % (long) Q) + Q) % Q;
+                for (long i = 0; i < N; i++)
+                    ASSERT_EQ((buf.data()[i] + rc) % Q, out.data()[i]);
+            }
+        }
+    }
+
+    TEST_F(CoeffBufferTest, ToZZX) {
+        util::CoeffBuffer buf(4, Q);
+        buf.fill(-515);
+        buf.negate_suffix(2);
+        NTL::ZZX poly;
+        buf.to_ZZX(poly);
+        ASSERT_EQ(-515L, NTL::to_long(NTL::coeff(poly, 0)));
+        ASSERT_EQ(-515L, NTL::to_long(NTL::coeff(poly, 1)));
+        ASSERT_EQ(515L, NTL::to_long(NTL::coeff(poly, 2)));
+        ASSERT_EQ(515L, NTL::to_long(NTL::coeff(poly, 3)));
+    }
+}
@@ -12,26 +12,52 @@
 
 #include "PrivateGreaterThan/GreaterThan.hpp"
 #include "network/PPDT.hpp"
+#include "util/literal.hpp"
 
-int play_server(std::string const& file) {
+/// A forest is given as the comma-separated models of its trees.
+int play_server(std::string const& file, ServerOptions const& opts, long key_cache_size) {
     PPDTServer server;
-    if (!server.load(file)) {
+    server.set_key_cache_size(key_cache_size);
+    if (!server.load(util::split_by(file, ','))) {
         std::cerr << "Error happened when to load file: " << file << std::endl;
         return -1;
     } else {
         auto server_routine = std::bind(&PPDTServer::run, server, std::placeholders::_1);
-        return run_server(server_routine);
+        ServerStats stats;
+        int ret = run_server(server_routine, opts, &stats);
+        stats.report(std::cout);
+        return ret;
     }
 }
 
-int play_client(std::string const& file) {
+/// Compile a text model into the binary format, which the server memory-maps at loading.
+int compile_model(std::string const& file, std::string const& output) {
+    PPDTServer server;
+    if (!server.load(file)) {
+        std::cerr << "Error happened when to load file: " << file << std::endl;
+        return -1;
+    }
+    if (!server.save(output)) {
+        std::cerr << "Error happened when to save file: " << output << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/// The client reconnects with the same keys, which are cached by the server after the first connection.
+int play_client(std::string const& file, long connections, bool packed, bool seeded) {
     PPDTClient client;
+    client.set_packed_response(packed);
+    client.set_seeded_upload(seeded);
     if (!client.load(file)) {
         std::cerr << "Error happened when to load file: " << file << std::endl;
         return -1;
     } else {
         auto client_routine = std::bind(&PPDTClient::run, client, std::placeholders::_1);
-        return run_client(client_routine);
+        int ret = 0;
+        for (long c = 0; c < connections; c++)
+            ret = run_client(client_routine);
+        return ret;
     }
 }
 
@@ -44,16 +70,35 @@ int main(int argc, char *argv[]) {
     ArgMapping amap;
     long role = 0;
     std::string input_file = "";
-    amap.arg("r", role, "role");
-    amap.arg("i", input_file, "server model or client's input");
+    std::string output_file = "";
+    long workers = 4, queue_depth = 16, sessions = -1, timeout = 600;
+    long key_cache_size = 8, connections = 1, packed = 0, seeded = 0;
+    amap.arg("r", role, "role: 0 client, 1 server, 2 compile the model");
+    amap.arg("i", input_file, "server model(s) or client's input");
+    amap.arg("o", output_file, "compiled model");
     amap.arg("p", network::port, "port");
     amap.arg("a", network::addr, "server addr");
+    amap.arg("w", workers, "server worker threads");
+    amap.arg("q", queue_depth, "server queue depth");
+    amap.arg("n", sessions, "server sessions before exit, -1 for never");
+    amap.arg("t", timeout, "server session timeout in seconds, 0 for none");
+    amap.arg("k", key_cache_size, "server cached client keys");
+    amap.arg("c", connections, "client connections with the same keys");
+    amap.arg("g", packed, "client asks for the packed response");
+    amap.arg("s", seeded, "client uploads seeded ciphertexts");
     amap.parse(argc, argv);
 
     if (role == 0) {
-        play_client(input_file);
+        play_client(input_file, connections, packed != 0, seeded != 0);
     } else if (role == 1) {
-        play_server(input_file);
+        ServerOptions opts;
+        opts.workers = workers;
+        opts.queue_depth = queue_depth;
+        opts.max_sessions = sessions;
+        opts.session_timeout = std::chrono::seconds(timeout);
+        play_server(input_file, opts, key_cache_size);
+    } else if (role == 2) {
+        compile_model(input_file, output_file);
     } else {
         amap.usage("Private Decision Tree");
     }
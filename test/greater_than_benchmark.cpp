@@ -6,6 +6,8 @@
 #include "SymRLWE/PrivateKey.hpp"
 #include "SymRLWE/types.hpp"
 #include "SymRLWE/GreaterThan.hpp"
+#include "SymRLWE/PolyOps.hpp"
+#include "SymRLWE/Timer.hpp"
 namespace testing
 {
  namespace internal
@@ -154,4 +156,68 @@ namespace {
                          gt_args, context);
         }
     }
+
+    /// Multiplying by 1 + X + ... + X^{N-1}: the O(N) kernel versus NTL::MulMod.
+    TEST_F(GreaterThanBenchmark, MulByTestVector) {
+        const long phiM = phi_N(M);
+        const long trials = 100;
+        GreaterThanArgs gt_args;
+        create_greater_than_args(&gt_args, 1L, 0L, context);
+        NTL::ZZX poly, result;
+        for (long i = 0; i < phiM; i++)
+            NTL::SetCoeff(poly, i, NTL::RandomBnd(prime));
+
+        auto start = Clock::now();
+        for (long i = 0; i < trials; i++)
+            NTL::MulMod(result, poly, gt_args.test_v, context.zMStar.getPhimX());
+        auto end = Clock::now();
+        double mulmod_time = time_as_millsecond(end - start) / trials;
+
+        start = Clock::now();
+        for (long i = 0; i < trials; i++)
+            mul_by_test_v(&result, poly, phiM);
+        end = Clock::now();
+        double kernel_time = time_as_millsecond(end - start) / trials;
+        PRINTF("MulMod %.3fms kernel %.3fms\n", mulmod_time, kernel_time);
+    }
+
+    /// Multiplying a cipher by the same plaintext: converting it every time, encoding it
+    /// once over the ciphertext primes only, and once over all the primes as the components.
+    TEST_F(GreaterThanBenchmark, MulByEncodedPlaintext) {
+        const long phiM = phi_N(M);
+        const long trials = 100;
+        NTL::ZZX poly;
+        for (long i = 0; i < phiM; i++)
+            NTL::SetCoeff(poly, i, NTL::RandomBnd(prime));
+        Cipher cipher, out;
+        key->EncryptOnDegree(&cipher, NTL::RandomBnd(phiM));
+
+        auto start = Clock::now();
+        for (long i = 0; i < trials; i++) {
+            out = cipher;
+            out *= poly;
+        }
+        auto end = Clock::now();
+        double zzx_time = time_as_millsecond(end - start) / trials;
+
+        const EncodedPlaintext ctxt_primes(poly, context);
+        start = Clock::now();
+        for (long i = 0; i < trials; i++) {
+            out = cipher;
+            out *= ctxt_primes;
+        }
+        end = Clock::now();
+        double ctxt_primes_time = time_as_millsecond(end - start) / trials;
+
+        const EncodedPlaintext all_primes(poly, context, context.allPrimes());
+        start = Clock::now();
+        for (long i = 0; i < trials; i++) {
+            out = cipher;
+            out *= all_primes;
+        }
+        end = Clock::now();
+        double all_primes_time = time_as_millsecond(end - start) / trials;
+        PRINTF("ZZX %.3fms ctxtPrimes %.3fms allPrimes %.3fms\n",
+               zzx_time, ctxt_primes_time, all_primes_time);
+    }
 }
@@ -6,6 +6,9 @@
 #include "SymRLWE/PrivateKey.hpp"
 #include "SymRLWE/types.hpp"
 #include "SymRLWE/GreaterThan.hpp"
+#include "SymRLWE/PolyOps.hpp"
+
+#include <sstream>
 
 namespace {
     const long M = 32;
@@ -63,6 +66,45 @@ namespace {
         }
     }
 
+    TEST_F(GreaterThanTest, MulByTestVector) {
+        const long phiM = phi_N(M);
+        GreaterThanArgs gt_args;
+        create_greater_than_args(&gt_args, 1L, 0L, context);
+        for (long trial = 0; trial < 100; trial++) {
+            NTL::ZZX poly;
+            for (long i = 0; i < phiM; i++)
+                NTL::SetCoeff(poly, i, NTL::RandomBnd(1031) - 515);
+            NTL::ZZX expected, computed;
+            NTL::MulMod(expected, poly, gt_args.test_v, context.zMStar.getPhimX());
+            mul_by_test_v(&computed, poly, phiM);
+            ASSERT_EQ(expected, computed);
+        }
+    }
+
+    TEST_F(GreaterThanTest, MulByMonomial) {
+        const long phiM = phi_N(M);
+        NTL::ZZX poly;
+        for (long i = 0; i < phiM; i++)
+            NTL::SetCoeff(poly, i, NTL::RandomBnd(1031) - 515);
+        for (long k = -2 * phiM; k <= 2 * phiM; k++) {
+            NTL::ZZX monomial, expected, computed;
+            encodeOnDegree(&monomial, k, context);
+            long r = ((k % (2 * phiM)) + 2 * phiM) % (2 * phiM);
+            if (r >= phiM)
+                monomial *= -1L;
+            NTL::MulMod(expected, poly, monomial, context.zMStar.getPhimX());
+            mul_by_monomial(&computed, poly, k, phiM);
+            ASSERT_EQ(expected, computed);
+        }
+
+        Cipher cipher;
+        key->EncryptOnDegree(&cipher, 1);
+        cipher.mul_by_monomial(-2); // X * X^{-2} = -X^{N - 1}
+        NTL::ZZX dec;
+        key->Decrypt(&dec, cipher);
+        ASSERT_EQ(-1L, NTL::to_long(NTL::coeff(dec, phiM - 1)));
+    }
+
     TEST_F(GreaterThanTest, RandomGeneratedValuesOnPlain) {
         const long numTrials = 100;
         std::vector<long> As(numTrials), Bs(numTrials);
@@ -105,6 +147,25 @@ namespace {
         }
     }
 
+    TEST_F(GreaterThanTest, EncodedThreshold) {
+        const long numTrials = 100;
+        const long phiM = phi_N(M);
+        GreaterThanArgs gt_args;
+        create_greater_than_args(&gt_args, 1L, 0L, context);
+
+        const long B = NTL::RandomBnd(phiM);
+        EncodedPlaintext enc_b = encode_threshold(B, gt_args, context);
+        for (long i = 0; i < numTrials; i++) {
+            const long A = NTL::RandomBnd(phiM);
+            Cipher enc_a;
+            key->EncryptOnDegree(&enc_a, A);
+            Cipher result = greater_than(enc_a, enc_b, gt_args, context);
+            NTL::ZZX dec;
+            key->Decrypt(&dec, result);
+            ASSERT_EQ(dec[0] == gt_args.gt(), A > B);
+        }
+    }
+
     TEST_F(GreaterThanTest, BoundaryCondition) {
         GreaterThanArgs gt_args;
         create_greater_than_args(&gt_args, 1L, 0L, context);
@@ -142,4 +203,172 @@ namespace {
             ASSERT_EQ(dec[0] == gt_args.gt(), other > v);
         }
     }
+
+    TEST_F(GreaterThanTest, SeededCipher) {
+        const long phiM = phi_N(M);
+        Cipher cipher;
+        key->EncryptOnDegree(&cipher, 3);
+        ASSERT_TRUE(cipher.is_seeded());
+
+        Cipher expanded(cipher);
+        expanded += 0L;
+        ASSERT_FALSE(expanded.is_seeded());
+
+        std::stringstream seeded_stream, full_stream;
+        ASSERT_TRUE(cipher.write(seeded_stream));
+        ASSERT_TRUE(expanded.write(full_stream));
+        EXPECT_LT(seeded_stream.str().size() * 3, full_stream.str().size() * 2);
+
+        /// Nothing to write from an empty or moved-from cipher.
+        std::stringstream empty_stream;
+        Cipher moved(std::move(expanded));
+        EXPECT_FALSE(Cipher().write(empty_stream));
+        EXPECT_FALSE(expanded.write(empty_stream));
+        EXPECT_TRUE(empty_stream.str().empty());
+
+        Cipher received;
+        ASSERT_TRUE(received.read(seeded_stream, context));
+        ASSERT_TRUE(received.is_seeded());
+        NTL::ZZX dec;
+        key->Decrypt(&dec, received);
+        ASSERT_EQ(1L, NTL::to_long(NTL::coeff(dec, 3)));
+
+        /// The first update expands b from the seed.
+        received.mul_by_monomial(-4); // X^3 * X^{-4} = -X^{N - 1}
+        ASSERT_FALSE(received.is_seeded());
+        key->Decrypt(&dec, received);
+        ASSERT_EQ(-1L, NTL::to_long(NTL::coeff(dec, phiM - 1)));
+
+        Cipher received_full;
+        ASSERT_TRUE(received_full.read(full_stream, context));
+        ASSERT_FALSE(received_full.is_seeded());
+        key->Decrypt(&dec, received_full);
+        ASSERT_EQ(1L, NTL::to_long(NTL::coeff(dec, 3)));
+    }
+
+    TEST_F(GreaterThanTest, PolynomialPool) {
+        auto &pool = *key->getPool();
+        PrivateKey copy(*key);
+        ASSERT_EQ(key->getPool(), copy.getPool());
+        auto round = [](long k) {
+            Cipher cipher;
+            key->EncryptOnDegree(&cipher, k);
+            Cipher result(cipher);
+            result.mul_by_monomial(-k); // X^0
+            NTL::ZZX dec;
+            key->Decrypt(&dec, result);
+            return NTL::to_long(NTL::coeff(dec, 0));
+        };
+        ASSERT_EQ(1L, round(0));
+        /// The steady state reuses the released polynomials without growing the pool.
+        const size_t idle = pool.idle();
+        ASSERT_GT(idle, 0UL);
+        for (long k = 1; k < 10; k++) {
+            ASSERT_EQ(1L, round(k));
+            ASSERT_EQ(idle, pool.idle());
+        }
+
+        const Polynomial *released = nullptr;
+        {
+            auto poly = pool.acquire();
+            released = poly.get();
+            ASSERT_EQ(idle - 1, pool.idle());
+        }
+        ASSERT_EQ(idle, pool.idle());
+        auto poly = pool.acquire();
+        ASSERT_EQ(released, poly.get());
+        ASSERT_EQ(key->getPool(), PolynomialPool::owner(poly));
+    }
+
+    TEST_F(GreaterThanTest, PolynomialPoolOutlivedByCipher) {
+        Cipher cipher;
+        {
+            PrivateKey temp(context);
+            temp.EncryptOnDegree(&cipher, 3);
+            cipher.mul_by_monomial(1); // expand b from the pool of temp
+        }
+        /// The pool is gone with its key, so the components are freed rather than returned,
+        /// and copies fall back to plain allocations.
+        Cipher copy(cipher);
+        copy += 1;
+        Cipher fresh;
+        key->EncryptOnDegree(&fresh, 0);
+        copy = fresh;
+        NTL::ZZX dec;
+        key->Decrypt(&dec, copy);
+        ASSERT_EQ(1L, NTL::to_long(NTL::coeff(dec, 0)));
+    }
+
+    TEST_F(GreaterThanTest, ValueSemantics) {
+        const long phiM = phi_N(M);
+        Cipher one, two;
+        key->EncryptOnDegree(&one, 1);
+        key->EncryptOnDegree(&two, 2);
+
+        /// Copies never share the components.
+        Cipher copy;
+        copy = one;
+        copy.mul_by_monomial(1);
+        NTL::ZZX dec;
+        key->Decrypt(&dec, one);
+        ASSERT_EQ(1L, NTL::to_long(NTL::coeff(dec, 1)));
+        key->Decrypt(&dec, copy);
+        ASSERT_EQ(1L, NTL::to_long(NTL::coeff(dec, 2)));
+
+        Cipher moved;
+        moved = std::move(copy);
+        key->Decrypt(&dec, moved);
+        ASSERT_EQ(1L, NTL::to_long(NTL::coeff(dec, 2)));
+        moved.swap(two);
+        key->Decrypt(&dec, moved);
+        ASSERT_EQ(1L, NTL::to_long(NTL::coeff(dec, 2)));
+
+        /// E(X) * 3 + 5
+        Cipher fused(one);
+        NTL::ZZX three;
+        NTL::SetCoeff(three, 0, 3);
+        fused.mul_add_constant(three, 5L);
+        key->Decrypt(&dec, fused);
+        ASSERT_EQ(5L, NTL::to_long(NTL::coeff(dec, 0)));
+        ASSERT_EQ(3L, NTL::to_long(NTL::coeff(dec, 1)));
+
+        /// greater_than_into() reuses the output buffer across the loop.
+        GreaterThanArgs gt_args;
+        create_greater_than_args(&gt_args, 1L, 0L, context);
+        Cipher enc_a, out;
+        for (long trial = 0; trial < 20; trial++) {
+            const long A = NTL::RandomBnd(phiM);
+            const long B = NTL::RandomBnd(phiM);
+            key->EncryptOnDegree(&enc_a, A);
+            greater_than_into(out, enc_a, B, gt_args, context);
+            key->Decrypt(&dec, out);
+            ASSERT_EQ(dec[0] == gt_args.gt(), A > B);
+            greater_than_into(out, enc_a, encode_threshold(B, gt_args, context), gt_args, context);
+            key->Decrypt(&dec, out);
+            ASSERT_EQ(dec[0] == gt_args.gt(), A > B);
+        }
+    }
+
+    /// An encoded threshold over the primes of the cipher gives the same result as the ZZX path.
+    TEST_F(GreaterThanTest, EncodedThresholdOverCipherPrimes) {
+        const long phiM = phi_N(M);
+        GreaterThanArgs gt_args;
+        create_greater_than_args(&gt_args, 1L, 0L, context);
+        Cipher enc_a, plain_out, encoded_out;
+        for (long trial = 0; trial < 20; trial++) {
+            const long A = NTL::RandomBnd(phiM);
+            const long B = NTL::RandomBnd(phiM);
+            EncodedPlaintext enc_b = encode_threshold(B, gt_args, context);
+            ASSERT_TRUE(enc_b.poly().getIndexSet() == context.allPrimes());
+
+            key->EncryptOnDegree(&enc_a, A);
+            greater_than_into(plain_out, enc_a, B, gt_args, context);
+            greater_than_into(encoded_out, enc_a, enc_b, gt_args, context);
+            NTL::ZZX plain_dec, encoded_dec;
+            key->Decrypt(&plain_dec, plain_out);
+            key->Decrypt(&encoded_dec, encoded_out);
+            ASSERT_EQ(plain_dec, encoded_dec);
+            ASSERT_EQ(encoded_dec[0] == gt_args.gt(), A > B);
+        }
+    }
 }
@@ -0,0 +1,185 @@
+#include <gtest/gtest.h>
+
+#include "network/PPDT.hpp"
+#include "network/net_io.hpp"
+#include "util/literal.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef PPDT_SAMPLES_DIR
+#define PPDT_SAMPLES_DIR "../samples"
+#endif
+
+namespace network {
+    int port = 12399;
+    std::string addr = "127.0.0.1";
+};
+
+namespace {
+    const std::string MODEL_FILE = std::string(PPDT_SAMPLES_DIR) + "/heart-disease.result";
+    const std::string FEATURE_FILE = "ppdt_loopback_test.features";
+
+    /// The text model, evaluated in the clear.
+    struct TextModel {
+        std::vector<long> thresholds;
+        std::map<long, long> feature;
+        std::vector<std::vector<long>> paths;
+        std::map<long, long> right; // the right child of a node is its next node on the first path through it
+
+        bool load(std::string const& file) {
+            std::ifstream fd(file);
+            std::string line;
+            if (!fd.is_open() || !std::getline(fd, line))
+                return false;
+            for (auto const& field : util::split_by(line, ','))
+                thresholds.push_back(std::stol(util::trim(field)));
+            if (!std::getline(fd, line))
+                return false;
+            for (auto const& field : util::split_by(line, ',')) {
+                auto pair = util::split_by(field, ':');
+                if (pair.size() != 2)
+                    return false;
+                feature[std::stol(pair[0])] = std::stol(pair[1]);
+            }
+            while (std::getline(fd, line)) {
+                line = util::trim(line);
+                if (line.size() < 2)
+                    continue;
+                std::vector<long> path;
+                for (auto const& field : util::split_by(line.substr(1, line.size() - 2), ','))
+                    path.push_back(std::stol(util::trim(field)));
+                for (size_t j = 0; j + 1 < path.size(); j++)
+                    right.insert({path[j], path[j + 1]});
+                paths.push_back(path);
+            }
+            return !paths.empty();
+        }
+
+        /// The label is the index of the path that x goes down, going right iff x[feature] > threshold.
+        long evaluate(std::vector<long> const& x) const {
+            for (size_t k = 0; k < paths.size(); k++) {
+                auto const& path = paths[k];
+                bool matched = true;
+                for (size_t j = 0; matched && j + 1 < path.size(); j++) {
+                    long node = path[j];
+                    bool greater = x.at(feature.at(node)) > thresholds.at(node);
+                    matched = (path[j + 1] == right.at(node)) == greater;
+                }
+                if (matched)
+                    return (long) k;
+            }
+            return -1;
+        }
+    };
+
+    /// One query down each path of the sample: the root compares x[12] with 4,
+    /// its children compare x[11] with 0, and then x[2] with 3 or x[8] with 0.
+    std::vector<std::vector<long>> make_batch() {
+        const std::vector<std::map<long, long>> settings = {
+            {{12, 5}, {11, 1}},
+            {{12, 5}, {11, 0}, {2, 4}},
+            {{12, 5}, {11, 0}, {2, 3}},
+            {{12, 4}, {11, 1}, {8, 1}},
+            {{12, 4}, {11, 1}, {8, 0}},
+            {{12, 4}, {11, 0}},
+        };
+        std::vector<std::vector<long>> batch;
+        for (auto const& setting : settings) {
+            std::vector<long> x(13);
+            for (size_t f = 0; f < x.size(); f++)
+                x[f] = (long) (f % 8);
+            for (auto const& kv : setting)
+                x[kv.first] = kv.second;
+            batch.push_back(x);
+        }
+        return batch;
+    }
+
+    bool write_batch(std::vector<std::vector<long>> const& batch) {
+        std::ofstream fd(FEATURE_FILE, std::ios::trunc);
+        for (auto const& x : batch) {
+            for (size_t f = 0; f < x.size(); f++)
+                fd << (f ? "," : "") << x[f];
+            fd << "\n";
+        }
+        return fd.good();
+    }
+
+    /// Connect until the server is listening.
+    int connect_and_run(PPDTClient &client) {
+        int ret = -1;
+        for (int tries = 0; ret < 0 && tries < 50; tries++) {
+            ret = run_client([&client](tcp::iostream &conn) { client.run(conn); });
+            if (ret < 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return ret;
+    }
+
+    struct Mode {
+        const char *name;
+        bool seeded;
+        bool packed;
+        int connections; // the later connections reuse the keys cached by the server
+    };
+
+    TEST(PPDTLoopback, AllModes) {
+        TextModel model;
+        ASSERT_TRUE(model.load(MODEL_FILE));
+        auto batch = make_batch();
+        ASSERT_TRUE(write_batch(batch));
+        std::vector<long> expected;
+        for (auto const& x : batch)
+            expected.push_back(model.evaluate(x));
+        for (size_t q = 0; q < expected.size(); q++)
+            ASSERT_EQ(expected[q], (long) q) << "the batch should take every path once";
+
+        PPDTServer server;
+        ASSERT_TRUE(server.load(MODEL_FILE));
+        const std::vector<Mode> modes = {
+            {"plain", false, false, 2},
+            {"seeded", true, false, 1},
+            {"packed", false, true, 1},
+            {"seeded and packed", true, true, 1},
+        };
+        std::atomic<bool> stop(false);
+        ServerOptions opts;
+        opts.workers = 2;
+        opts.max_sessions = 0;
+        for (auto const& mode : modes)
+            opts.max_sessions += mode.connections;
+        opts.stop = &stop;
+        std::thread serving([&server, &opts]() {
+            run_server([&server](tcp::iostream &conn) { server.run(conn); }, opts);
+        });
+
+        for (auto const& mode : modes) {
+            PPDTClient client;
+            client.set_seeded_upload(mode.seeded);
+            client.set_packed_response(mode.packed);
+            EXPECT_TRUE(client.load(FEATURE_FILE));
+            for (int c = 0; c < mode.connections; c++) {
+                EXPECT_EQ(connect_and_run(client), 1) << mode.name;
+                auto labels = client.labels();
+                EXPECT_EQ(labels.size(), batch.size()) << mode.name << " connection " << c;
+                for (size_t q = 0; q < labels.size() && q < batch.size(); q++) {
+                    EXPECT_EQ(labels[q].size(), 1UL) << mode.name;
+                    if (!labels[q].empty()) {
+                        EXPECT_EQ(labels[q][0], expected[q]) << mode.name << " query " << q;
+                    }
+                }
+            }
+        }
+        /// no assertion returns before here, the server thread must be joined
+        stop = true;
+        serving.join();
+        std::remove(FEATURE_FILE.c_str());
+    }
+}
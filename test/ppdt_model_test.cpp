@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include "network/PPDTModel.hpp"
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+    const std::string FILE_NAME = "ppdt_model_test.ppdt";
+
+    /// node 0: x[2] vs 5, the left child is the leaf of path 2, the right one is node 1.
+    /// node 1: x[0] vs 7, the left child is the leaf of path 1, the right one is the leaf of path 0.
+    bool build_sample(PPDTModel &model) {
+        return model.build({2, 0}, {5, 7}, {-3, -2}, {1, -1},
+                           {{0, 1}, {0, 1}, {0}}, {0, 1, 1});
+    }
+
+    /// The word positions in the layout of the sample, see PPDTModel.
+    enum Word : size_t {
+        NODES = 2, PATHS = 3, MAX_FEATURE = 5,
+        LEFT = 10, RIGHT = 12, PATH_NODE = 18, LEFT_TURNS = 23, WORDS = 26
+    };
+
+    std::vector<int64_t> sample_words() {
+        PPDTModel model;
+        EXPECT_TRUE(build_sample(model));
+        EXPECT_TRUE(model.save(FILE_NAME));
+        std::ifstream fd(FILE_NAME, std::ios::binary);
+        std::vector<int64_t> words(WORDS);
+        fd.read(reinterpret_cast<char *>(words.data()), WORDS * sizeof(int64_t));
+        EXPECT_EQ(fd.gcount(), (std::streamsize) (WORDS * sizeof(int64_t)));
+        return words;
+    }
+
+    bool map_words(std::vector<int64_t> const& words) {
+        {
+            std::ofstream fd(FILE_NAME, std::ios::binary | std::ios::trunc);
+            fd.write(reinterpret_cast<const char *>(words.data()), words.size() * sizeof(int64_t));
+        }
+        PPDTModel model;
+        bool ok = model.map(FILE_NAME);
+        std::remove(FILE_NAME.c_str());
+        return ok;
+    }
+
+    bool map_with(size_t pos, int64_t value) {
+        std::vector<int64_t> words = sample_words();
+        words.at(pos) = value;
+        return map_words(words);
+    }
+
+    TEST(PPDTModel, BuildSaveMap) {
+        PPDTModel built;
+        ASSERT_TRUE(build_sample(built));
+        ASSERT_TRUE(built.save(FILE_NAME));
+        ASSERT_TRUE(PPDTModel::is_compiled(FILE_NAME));
+
+        PPDTModel mapped;
+        ASSERT_TRUE(mapped.map(FILE_NAME));
+        std::remove(FILE_NAME.c_str());
+        for (PPDTModel const* model : {&built, &mapped}) {
+            ASSERT_EQ(model->nodes_count(), 2UL);
+            ASSERT_EQ(model->paths_count(), 3UL);
+            ASSERT_EQ(model->max_feature_index(), 2L);
+            EXPECT_EQ(model->feature()[0], 2);
+            EXPECT_EQ(model->threshold()[1], 7);
+            EXPECT_EQ(model->left()[0], -3);
+            EXPECT_EQ(model->right()[0], 1);
+            EXPECT_EQ(model->path_end(0) - model->path_begin(0), 2);
+            EXPECT_EQ(model->path_end(2) - model->path_begin(2), 1);
+            EXPECT_EQ(model->left_turns(1), 1L);
+        }
+    }
+
+    TEST(PPDTModel, SingleLeaf) {
+        PPDTModel model;
+        ASSERT_TRUE(model.build({}, {}, {}, {}, {{}}, {0}));
+        EXPECT_EQ(model.nodes_count(), 0UL);
+        EXPECT_EQ(model.paths_count(), 1UL);
+        EXPECT_EQ(model.max_feature_index(), -1L);
+        /// a tree without any path
+        EXPECT_FALSE(model.build({}, {}, {}, {}, {}, {}));
+    }
+
+    TEST(PPDTModel, RejectMalformedFile) {
+        ASSERT_TRUE(map_words(sample_words()));
+
+        std::vector<int64_t> words = sample_words();
+        words.pop_back();
+        EXPECT_FALSE(map_words(words)) << "truncated";
+        /// counts whose total word count overflows
+        EXPECT_FALSE(map_with(NODES, std::numeric_limits<int64_t>::max() / 2));
+        EXPECT_FALSE(map_with(PATHS, std::numeric_limits<int64_t>::max() / 2));
+        /// children out of range
+        EXPECT_FALSE(map_with(LEFT, std::numeric_limits<int64_t>::min()));
+        EXPECT_FALSE(map_with(LEFT, -4));
+        EXPECT_FALSE(map_with(RIGHT, 2));
+        /// a cycle back to the root
+        EXPECT_FALSE(map_with(RIGHT + 1, 0));
+        /// a node reached twice, which leaves a leaf unreached
+        EXPECT_FALSE(map_with(LEFT, 1));
+        /// two paths ending at the same leaf
+        EXPECT_FALSE(map_with(LEFT + 1, -1));
+        /// a path that does not start from the root
+        EXPECT_FALSE(map_with(PATH_NODE + 4, 1));
+        /// a path that skips a node on the way to its leaf
+        EXPECT_FALSE(map_with(PATH_NODE + 1, 0));
+        EXPECT_FALSE(map_with(LEFT_TURNS, 1));
+        /// a max feature index that would over-allocate the features
+        EXPECT_FALSE(map_with(MAX_FEATURE, 1L << 40));
+
+        /// a tree without any path: the header and path_offset[0]
+        EXPECT_FALSE(map_words({PPDTModel::MAGIC, PPDTModel::VERSION, 0, 0, 0, -1, 0}));
+    }
+}
@@ -6,6 +6,7 @@
 
 #include "PrivateGreaterThan/GreaterThan.hpp"
 #include "SymRLWE/PrivateKey.hpp"
+#include "SymRLWE/Timer.hpp"
 namespace testing
 {
  namespace internal
@@ -44,6 +45,7 @@ namespace {
             secret_key = new FHESecKey(context);
             secret_key->GenSecKey(64);
             setup_auxiliary_for_greater_than(secret_key);
+            setup_auxiliary_for_packing(secret_key);
             public_key = new FHEPubKey(*secret_key);
         }
         static void TearDownTestCase() {
@@ -155,6 +157,26 @@ namespace {
         }
     }
 
+    TEST_F(PrivateGreaterThanTest, CachedThreshold) {
+        GreaterThanArgs gt_args;
+        gt_args = create_greater_than_args(1L, 0L, context);
+        ThresholdCache cache(context);
+
+        const long phiM = phi_N(M);
+        const long B = NTL::RandomBnd(phiM);
+        for (long i = 0; i < TRIALS; i++) {
+            const long A = NTL::RandomBnd(phiM);
+            Ctxt enc_A = encrypt_in_degree(A, *public_key);
+
+            Ctxt result = greater_than(enc_A, cache.get(B, gt_args), gt_args, context);
+            ASSERT_TRUE(result.isCorrect());
+            NTL::ZZX dec;
+            secret_key->Decrypt(dec, result);
+            ASSERT_EQ(dec[0] == gt_args.gt(), A > B);
+        }
+        ASSERT_EQ(1UL, cache.size());
+    }
+
     TEST_F(PrivateGreaterThanTest, BoundaryCondition) {
         GreaterThanArgs gt_args;
         gt_args = create_greater_than_args(1L, 0L, context);
@@ -241,6 +263,81 @@ namespace {
         }
     }
 
+    TEST_F(PrivateGreaterThanTest, EqualityTestPolynomial) {
+        const long phiM = phi_N(M);
+        const long p = context.alMod.getPPowR();
+        for (long i = 0; i < TRIALS; i++) {
+            long v = NTL::RandomBnd(phiM);
+            long u = i & 1 ? v : NTL::RandomBnd(phiM);
+            Ctxt enc_v = encrypt_in_degree(v, *public_key);
+            Ctxt enc_u = encrypt_in_degree(u, *public_key);
+
+            /// 1 - X^{v - u}, where X^{v - u} = -X^{N + v - u} for v < u
+            NTL::ZZX expected;
+            NTL::SetCoeff(expected, 0, 1);
+            if (v >= u)
+                NTL::SetCoeff(expected, v - u, NTL::coeff(expected, v - u) - 1);
+            else
+                NTL::SetCoeff(expected, phiM + v - u, 1);
+            for (long d = 0; d <= NTL::deg(expected); d++)
+                NTL::SetCoeff(expected, d, (NTL::coeff(expected, d) + p) % p);
+            expected.normalize();
+
+            NTL::ZZX dec;
+            secret_key->Decrypt(dec, equality_test(enc_v, enc_u, context, false));
+            ASSERT_EQ(expected, dec);
+            /// The randomization keeps the constant term
+            secret_key->Decrypt(dec, equality_test(enc_v, enc_u, context, true));
+            ASSERT_EQ(NTL::coeff(expected, 0), NTL::coeff(dec, 0));
+        }
+    }
+
+    TEST_F(PrivateGreaterThanTest, EncodedTestVector) {
+        const long phiM = phi_N(M);
+        for (bool randomized : {false, true}) {
+            GreaterThanArgs gt_args = create_greater_than_args(0L, 1L, context);
+            gt_args.randomized = randomized;
+            const EncodedPlaintext test_v = encode_test_v(gt_args, context);
+            for (long i = 0; i < TRIALS; i++) {
+                const long A = NTL::RandomBnd(phiM);
+                const long B = i % 3 == 0 ? A : NTL::RandomBnd(phiM);
+                Ctxt enc_A = encrypt_in_degree(A, *public_key);
+                Ctxt enc_B = encrypt_in_degree(B, *public_key);
+
+                NTL::ZZX plain, encoded;
+                secret_key->Decrypt(plain, greater_than(enc_A, enc_B, gt_args, context));
+                secret_key->Decrypt(encoded, greater_than(enc_A, enc_B, gt_args, test_v, context));
+                ASSERT_EQ(NTL::coeff(encoded, 0) == gt_args.gt(), A > B);
+                if (randomized)
+                    ASSERT_EQ(NTL::coeff(plain, 0), NTL::coeff(encoded, 0));
+                else
+                    ASSERT_EQ(plain, encoded);
+            }
+        }
+    }
+
+    TEST_F(PrivateGreaterThanTest, EncodedCountLessThan) {
+        const long maximum = phi_N(M) - 1;
+        const EncodedPlaintext test_v = encode_test_v(create_greater_than_args(1L, 0L, context), context);
+        for (long i = 0; i < TRIALS; i++) {
+            long a = NTL::RandomBnd(maximum);
+            Ctxt ctx_a = encrypt_in_degree(a, *public_key);
+            std::vector<Ctxt> ctx_b_vec;
+            long ground_true = 0;
+            for (long j = 0; j < TRIALS; j++) {
+                long b = j == 0 ? a : NTL::RandomBnd(maximum);
+                ctx_b_vec.emplace_back(encrypt_in_degree(b, *public_key));
+                ground_true += a > b ? 1 : 0;
+            }
+
+            NTL::ZZX plain, encoded;
+            secret_key->Decrypt(plain, count_less_than(ctx_a, ctx_b_vec, context));
+            secret_key->Decrypt(encoded, count_less_than(ctx_a, ctx_b_vec, test_v, context));
+            ASSERT_EQ(NTL::coeff(plain, 0), NTL::coeff(encoded, 0));
+            ASSERT_EQ(ground_true % context.alMod.getPPowR(), NTL::to_long(NTL::coeff(encoded, 0)));
+        }
+    }
+
     TEST_F(PrivateGreaterThanTest, CountLessThan) {
         const long maximum = phi_N(M) - 1;
         long a = NTL::RandomBnd(maximum);
@@ -263,4 +360,88 @@ namespace {
         ground_true %= context.alMod.getPPowR();
         EXPECT_EQ(ground_true, coeff);
     }
+
+    TEST_F(PrivateGreaterThanTest, BatchGreaterThan) {
+        GreaterThanArgs gt_args = create_greater_than_args(1L, 0L, context);
+        const long domain = 64;
+        const long lanes = batch_lanes(domain, context);
+        const long B = NTL::RandomBnd(domain);
+        std::vector<long> A(lanes);
+        for (long j = 0; j < lanes; j++)
+            A[j] = NTL::RandomBnd(domain);
+        Ctxt enc_A(*public_key);
+        encrypt_batch(enc_A, A, domain, *public_key);
+        Ctxt result = greater_than_batch(enc_A, B, domain, gt_args, context);
+        ASSERT_TRUE(result.isCorrect());
+        NTL::ZZX dec;
+        secret_key->Decrypt(dec, result);
+        auto bits = decode_batch(dec, lanes, context);
+        for (long j = 0; j < lanes; j++)
+            ASSERT_EQ(bits[j] == gt_args.gt(), A[j] > B);
+    }
+
+    TEST_F(PrivateGreaterThanTest, BatchGreaterThanCiphertexts) {
+        GreaterThanArgs gt_args = create_greater_than_args(1L, 0L, context);
+        std::vector<long> domains = {2, 16, 256, phi_N(M)};
+        for (long domain : domains) {
+            const long lanes = batch_lanes(domain, context);
+            const long B = NTL::RandomBnd(domain);
+            std::vector<long> A(lanes);
+            for (long j = 0; j < lanes; j++)
+                A[j] = NTL::RandomBnd(domain);
+            Ctxt enc_A(*public_key), enc_B(*public_key);
+            encrypt_batch(enc_A, A, domain, *public_key);
+            encrypt_batch(enc_B, {B}, domain, *public_key);
+            auto start = Clock::now();
+            Ctxt result = greater_than_batch(enc_A, enc_B, domain, gt_args, context);
+            auto end = Clock::now();
+            ASSERT_TRUE(result.isCorrect());
+            NTL::ZZX dec;
+            secret_key->Decrypt(dec, result);
+            auto bits = decode_batch(dec, lanes, context);
+            for (long j = 0; j < lanes; j++)
+                ASSERT_EQ(bits[j] == gt_args.gt(), A[j] > B);
+            PRINTF("domain %ld: %ld comparisons in %f ms\n", domain, lanes,
+                   time_as_millsecond(end - start));
+        }
+    }
+
+    TEST_F(PrivateGreaterThanTest, WideGreaterThan) {
+        std::vector<long> widths = {16, 32, 64};
+        GreaterThanArgs gt_args = create_greater_than_args(0L, 1L, context);
+        /// bad widths and values that do not fit them are rejected
+        EXPECT_EQ(0L, wide_digits(0, context));
+        EXPECT_EQ(0L, wide_digits(65, context));
+        EXPECT_TRUE(encrypt_wide(1UL << 16, 16, *public_key).empty());
+        EXPECT_TRUE(encrypt_wide(1UL, -1, *public_key).empty());
+        {
+            /// b wider than the digits of a is greater than any a
+            auto enc_A = encrypt_wide(0xFFFFUL, 16, *public_key);
+            NTL::ZZX dec;
+            secret_key->Decrypt(dec, greater_than_wide(enc_A, 1UL << 40, gt_args, context));
+            EXPECT_EQ(NTL::coeff(dec, 0), gt_args.ngt());
+        }
+        for (long bits : widths) {
+            const uint64_t mask = bits == 64 ? ~0UL : (1UL << bits) - 1;
+            for (long i = 0; i < 10; i++) {
+                const uint64_t A = NTL::RandomWord() & mask;
+                /// Equal values and values differing only in the lowest digit as well
+                const uint64_t B = i % 3 == 0 ? A : (i % 3 == 1 ? A ^ 1UL : NTL::RandomWord() & mask);
+                auto enc_A = encrypt_wide(A, bits, *public_key);
+                auto enc_B = encrypt_wide(B, bits, *public_key);
+                ASSERT_EQ(wide_digits(bits, context), static_cast<long>(enc_A.size()));
+
+                NTL::ZZX dec;
+                Ctxt result = greater_than_wide(enc_A, enc_B, gt_args, context);
+                ASSERT_TRUE(result.isCorrect());
+                secret_key->Decrypt(dec, result);
+                ASSERT_EQ(NTL::coeff(dec, 0) == gt_args.gt(), A > B);
+
+                result = greater_than_wide(enc_A, B, gt_args, context);
+                ASSERT_TRUE(result.isCorrect());
+                secret_key->Decrypt(dec, result);
+                ASSERT_EQ(NTL::coeff(dec, 0) == gt_args.gt(), A > B);
+            }
+        }
+    }
 }
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <HElib/FHE.h>
+#include <HElib/FHEContext.h>
+
+#include "PrivateGreaterThan/GreaterThan.hpp"
+#include "network/wire.hpp"
+#include "SymRLWE/Timer.hpp"
+
+#include <sstream>
+namespace testing
+{
+ namespace internal
+ {
+   enum GTestColor {
+         COLOR_DEFAULT,
+         COLOR_RED,
+         COLOR_GREEN,
+         COLOR_YELLOW
+     };
+
+   extern void ColoredPrintf(GTestColor color, const char* fmt, ...);
+  }
+}
+
+#define PRINTF(...)  \
+    do { \
+        testing::internal::ColoredPrintf(testing::internal::COLOR_GREEN, "[          ] "); \
+        testing::internal::ColoredPrintf(testing::internal::COLOR_YELLOW, __VA_ARGS__); } \
+    while(0)
+
+/// Compare the response of one (summation, label) pair per path with the packed response
+/// of PPDTServer::Session::evaluate_packed(). The parameters are the same as PPDTClient.
+namespace {
+    const long M = 4096 << 1;
+    const long prime = 1031;
+    const long level = 3;
+    FHEcontext *context = nullptr;
+    FHESecKey *secret_key = nullptr;
+    FHEPubKey *evk = nullptr;
+
+    class ResponsePackingBenchmark : public ::testing::Test {
+    protected:
+        static void SetUpTestCase() {
+            context = new FHEcontext(M, prime, 1);
+            context->bitsPerLevel += 1;
+            buildModChain(*context, level);
+            secret_key = new FHESecKey(*context);
+            secret_key->GenSecKey(64);
+            setup_auxiliary_for_greater_than(secret_key);
+            setup_auxiliary_for_packing(secret_key);
+            evk = new FHEPubKey(*secret_key);
+            evk->makeSymmetric();
+        }
+
+        static void TearDownTestCase() {
+            delete evk;
+            delete secret_key;
+            delete context;
+        }
+
+        /// Two ciphertexts per path, as PPDTServer sends them.
+        /// Like the blinded path sums, the ciphertexts encrypt full random polynomials,
+        /// and only their constant terms should come back from the packing.
+        void run(long paths) const {
+            const long N = phi_N(M);
+            const long slots = paths * 2;
+            std::vector<long> values(slots);
+            std::vector<Ctxt> cts(slots, *secret_key);
+            for (long i = 0; i < slots; i++) {
+                values[i] = NTL::RandomBnd(prime);
+                NTL::ZZX poly;
+                for (long j = 1; j < N; j++)
+                    NTL::SetCoeff(poly, j, NTL::RandomBnd(prime));
+                NTL::SetCoeff(poly, 0, values[i]);
+                secret_key->Encrypt(cts[i], poly);
+            }
+
+            std::stringstream pairs;
+            auto start = Clock::now();
+            for (auto ct : cts) {
+                ct.modDownToLevel(1);
+                wire::send_ctxt(pairs, ct);
+            }
+            auto end = Clock::now();
+            double pairs_server = time_as_millsecond(end - start);
+
+            NTL::ZZX poly;
+            Ctxt received(*secret_key);
+            start = Clock::now();
+            for (long i = 0; i < slots; i++) {
+                ASSERT_TRUE(wire::receive_ctxt(pairs, received));
+                secret_key->Decrypt(poly, received);
+                EXPECT_EQ(values[i], NTL::to_long(NTL::coeff(poly, 0)));
+            }
+            end = Clock::now();
+            double pairs_client = time_as_millsecond(end - start);
+
+            long n = 1;
+            while (n < slots && n < N)
+                n <<= 1;
+            const long packs = (slots + n - 1) / n;
+            std::stringstream packed;
+            start = Clock::now();
+            for (long k = 0; k < packs; k++) {
+                std::vector<const Ctxt *> pack(n, nullptr);
+                for (long j = 0; j < n && k * n + j < slots; j++)
+                    pack[j] = &cts[k * n + j];
+                Ctxt ct = pack_constants(pack, *evk);
+                ct.modDownToLevel(1);
+                wire::send_ctxt(packed, ct);
+            }
+            end = Clock::now();
+            double packed_server = time_as_millsecond(end - start);
+
+            start = Clock::now();
+            for (long k = 0; k < packs; k++) {
+                ASSERT_TRUE(wire::receive_ctxt(packed, received));
+                secret_key->Decrypt(poly, received);
+                auto unpacked = unpack_constants(poly, n, *context);
+                ASSERT_EQ(n, (long) unpacked.size());
+                for (long j = 0; j < n && k * n + j < slots; j++)
+                    EXPECT_EQ(values[k * n + j], unpacked[j]);
+                /// the trace kills all the coefficients but those of the slots
+                for (long j = 0; j < N; j++) {
+                    if (j % (N / n) != 0) {
+                        EXPECT_EQ(0, NTL::rem(NTL::coeff(poly, j), prime)) << j;
+                    }
+                }
+            }
+            end = Clock::now();
+            double packed_client = time_as_millsecond(end - start);
+
+            PRINTF("%ld paths bytes: pairs %zd packed %zd\n", paths,
+                   pairs.str().size(), packed.str().size());
+            PRINTF("%ld paths server: pairs %f ms packed %f ms\n", paths,
+                   pairs_server, packed_server);
+            PRINTF("%ld paths client: pairs %ld decryptions %f ms packed %ld decryptions %f ms\n",
+                   paths, slots, pairs_client, packs, packed_client);
+        }
+    };
+
+    /// The number of paths of samples/heart-disease, housing and spambase.
+    TEST_F(ResponsePackingBenchmark, HeartDisease) {
+        run(6);
+    }
+
+    TEST_F(ResponsePackingBenchmark, Housing) {
+        run(44);
+    }
+
+    TEST_F(ResponsePackingBenchmark, Spambase) {
+        run(59);
+    }
+}
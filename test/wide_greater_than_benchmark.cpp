@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <HElib/FHE.h>
+#include <HElib/FHEContext.h>
+
+#include "PrivateGreaterThan/GreaterThan.hpp"
+#include "SymRLWE/Timer.hpp"
+
+namespace testing
+{
+ namespace internal
+ {
+   enum GTestColor {
+         COLOR_DEFAULT,
+         COLOR_RED,
+         COLOR_GREEN,
+         COLOR_YELLOW
+     };
+
+   extern void ColoredPrintf(GTestColor color, const char* fmt, ...);
+  }
+}
+
+#define PRINTF(...)  \
+    do { \
+        testing::internal::ColoredPrintf(testing::internal::COLOR_GREEN, "[          ] "); \
+        testing::internal::ColoredPrintf(testing::internal::COLOR_YELLOW, __VA_ARGS__); } \
+    while(0)
+
+/// Comparisons of 16-, 32- and 64-bit values by greater_than_wide().
+/// The parameters are the same as PPDTClient, except the levels for combining the digits.
+namespace {
+    const long M = 4096 << 1;
+    const long prime = 1031;
+    const long level = 5;
+    const long TRIALS = 20;
+    FHEcontext *context = nullptr;
+    FHESecKey *secret_key = nullptr;
+    FHEPubKey *public_key = nullptr;
+
+    class WideGreaterThanBenchmark : public ::testing::Test {
+    protected:
+        static void SetUpTestCase() {
+            context = new FHEcontext(M, prime, 1);
+            context->bitsPerLevel += 1;
+            buildModChain(*context, level);
+            secret_key = new FHESecKey(*context);
+            secret_key->GenSecKey(64);
+            setup_auxiliary_for_greater_than(secret_key);
+            setup_auxiliary_for_packing(secret_key);
+            public_key = new FHEPubKey(*secret_key);
+        }
+
+        static void TearDownTestCase() {
+            delete public_key;
+            delete secret_key;
+            delete context;
+        }
+
+        void run(long bits) const {
+            const uint64_t mask = bits == 64 ? ~0UL : (1UL << bits) - 1;
+            std::vector<uint64_t> A(TRIALS), B(TRIALS);
+            std::vector<std::vector<Ctxt>> enc_A, enc_B;
+            auto start = Clock::now();
+            for (long i = 0; i < TRIALS; i++) {
+                A[i] = NTL::RandomWord() & mask;
+                B[i] = NTL::RandomWord() & mask;
+                enc_A.emplace_back(encrypt_wide(A[i], bits, *secret_key));
+                enc_B.emplace_back(encrypt_wide(B[i], bits, *secret_key));
+            }
+            auto end = Clock::now();
+            double enc_time = time_as_millsecond(end - start) / (2 * TRIALS);
+
+            GreaterThanArgs gt_args = create_greater_than_args(0L, 1L, *context);
+            std::vector<Ctxt> two_ctxts, one_ctxt;
+            start = Clock::now();
+            for (long i = 0; i < TRIALS; i++)
+                two_ctxts.emplace_back(greater_than_wide(enc_A[i], enc_B[i], gt_args, *context));
+            end = Clock::now();
+            double two_time = time_as_millsecond(end - start) / TRIALS;
+            for (long i = 0; i < TRIALS; i++)
+                one_ctxt.emplace_back(greater_than_wide(enc_A[i], B[i], gt_args, *context));
+            auto end2 = Clock::now();
+            double one_time = time_as_millsecond(end2 - end) / TRIALS;
+
+            NTL::ZZX dec;
+            for (long i = 0; i < TRIALS; i++) {
+                secret_key->Decrypt(dec, two_ctxts[i]);
+                EXPECT_EQ(NTL::coeff(dec, 0) == gt_args.gt(), A[i] > B[i]);
+                secret_key->Decrypt(dec, one_ctxt[i]);
+                EXPECT_EQ(NTL::coeff(dec, 0) == gt_args.gt(), A[i] > B[i]);
+            }
+            PRINTF("%ld bits (%ld digits): encrypt %f ms, compare two ctxts %f ms, one ctxt %f ms\n",
+                   bits, wide_digits(bits, *context), enc_time, two_time, one_time);
+        }
+    };
+
+    TEST_F(WideGreaterThanBenchmark, Bits16) {
+        run(16);
+    }
+
+    TEST_F(WideGreaterThanBenchmark, Bits32) {
+        run(32);
+    }
+
+    TEST_F(WideGreaterThanBenchmark, Bits64) {
+        run(64);
+    }
+}
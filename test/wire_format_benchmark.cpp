@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <HElib/FHE.h>
+#include <HElib/FHEContext.h>
+
+#include "PrivateGreaterThan/GreaterThan.hpp"
+#include "network/net_io.hpp"
+#include "network/wire.hpp"
+#include "SymRLWE/Timer.hpp"
+
+#include <sstream>
+namespace testing
+{
+ namespace internal
+ {
+   enum GTestColor {
+         COLOR_DEFAULT,
+         COLOR_RED,
+         COLOR_GREEN,
+         COLOR_YELLOW
+     };
+
+   extern void ColoredPrintf(GTestColor color, const char* fmt, ...);
+  }
+}
+
+#define PRINTF(...)  \
+    do { \
+        testing::internal::ColoredPrintf(testing::internal::COLOR_GREEN, "[          ] "); \
+        testing::internal::ColoredPrintf(testing::internal::COLOR_YELLOW, __VA_ARGS__); } \
+    while(0)
+
+/// Compare the decimal text streams with the binary frames of network/wire.hpp.
+/// The parameters are the same as PPDTClient.
+namespace {
+    const long M = 4096 << 1;
+    const long prime = 1031;
+    const long level = 3;
+    const long TRIALS = 10;
+    FHEcontext *context = nullptr;
+    FHESecKey *secret_key = nullptr;
+    FHEPubKey *evk = nullptr;
+
+    class WireFormatBenchmark : public ::testing::Test {
+    protected:
+        static void SetUpTestCase() {
+            context = new FHEcontext(M, prime, 1);
+            context->bitsPerLevel += 1;
+            buildModChain(*context, level);
+            secret_key = new FHESecKey(*context);
+            secret_key->GenSecKey(64);
+            setup_auxiliary_for_greater_than(secret_key);
+            evk = new FHEPubKey(*secret_key);
+            evk->makeSymmetric();
+        }
+
+        static void TearDownTestCase() {
+            delete evk;
+            delete secret_key;
+            delete context;
+        }
+    };
+
+    TEST_F(WireFormatBenchmark, Context) {
+        std::stringstream text, binary;
+        send_context(text, *context);
+        wire::send_context(binary, *context);
+        PRINTF("context bytes: text %zd binary %zd\n", text.str().size(), binary.str().size());
+
+        auto start = Clock::now();
+        FHEcontext from_text = receive_context(text);
+        auto end = Clock::now();
+        auto from_binary = wire::receive_context(binary);
+        auto end2 = Clock::now();
+        ASSERT_TRUE(from_binary != nullptr);
+        EXPECT_TRUE(*from_binary == *context);
+        PRINTF("context decode: text %f ms binary %f ms\n",
+               time_as_millsecond(end - start), time_as_millsecond(end2 - end));
+    }
+
+    TEST_F(WireFormatBenchmark, EvaluationKey) {
+        std::stringstream text, binary;
+        auto start = Clock::now();
+        text << *evk;
+        auto end = Clock::now();
+        wire::send_pubkey(binary, *evk);
+        auto end2 = Clock::now();
+        PRINTF("evk bytes: text %zd binary %zd\n", text.str().size(), binary.str().size());
+        PRINTF("evk encode: text %f ms binary %f ms\n",
+               time_as_millsecond(end - start), time_as_millsecond(end2 - end));
+
+        FHEPubKey from_text(*context), from_binary(*context);
+        start = Clock::now();
+        text >> from_text;
+        end = Clock::now();
+        ASSERT_TRUE(wire::receive_pubkey(binary, from_binary));
+        end2 = Clock::now();
+        EXPECT_TRUE(from_binary == *evk);
+        PRINTF("evk decode: text %f ms binary %f ms\n",
+               time_as_millsecond(end - start), time_as_millsecond(end2 - end));
+    }
+
+    TEST_F(WireFormatBenchmark, Ciphertext) {
+        const long phiM = phi_N(M);
+        std::vector<Ctxt> ctxts(TRIALS, *secret_key);
+        std::vector<long> values(TRIALS);
+        for (long i = 0; i < TRIALS; i++) {
+            values[i] = NTL::RandomBnd(phiM);
+            encrypt_in_degree(ctxts[i], values[i], *secret_key);
+        }
+
+        std::stringstream text, binary;
+        auto start = Clock::now();
+        for (auto const& ctx : ctxts)
+            text << ctx;
+        auto end = Clock::now();
+        for (auto const& ctx : ctxts)
+            wire::send_ctxt(binary, ctx);
+        auto end2 = Clock::now();
+        PRINTF("%ld ctxts bytes: text %zd binary %zd\n", TRIALS,
+               text.str().size(), binary.str().size());
+        PRINTF("%ld ctxts encode: text %f ms binary %f ms\n", TRIALS,
+               time_as_millsecond(end - start), time_as_millsecond(end2 - end));
+
+        Ctxt ctx(*secret_key);
+        start = Clock::now();
+        for (long i = 0; i < TRIALS; i++)
+            text >> ctx;
+        end = Clock::now();
+        std::vector<Ctxt> received(TRIALS, *secret_key);
+        for (long i = 0; i < TRIALS; i++)
+            ASSERT_TRUE(wire::receive_ctxt(binary, received[i]));
+        end2 = Clock::now();
+        PRINTF("%ld ctxts decode: text %f ms binary %f ms\n", TRIALS,
+               time_as_millsecond(end - start), time_as_millsecond(end2 - end));
+
+        NTL::ZZX poly;
+        for (long i = 0; i < TRIALS; i++) {
+            NTL::ZZX expected;
+            secret_key->Decrypt(expected, ctxts[i]);
+            secret_key->Decrypt(poly, received[i]);
+            EXPECT_TRUE(poly == expected);
+        }
+    }
+
+    TEST_F(WireFormatBenchmark, SeededCiphertext) {
+        const long phiM = phi_N(M);
+        const double noise_var = fresh_noise_var(*secret_key);
+        std::vector<long> values(TRIALS);
+        std::vector<Ctxt> ctxts(TRIALS, *secret_key);
+        std::vector<SeededCtxt> seeded(TRIALS);
+        auto start = Clock::now();
+        for (long i = 0; i < TRIALS; i++) {
+            values[i] = NTL::RandomBnd(phiM);
+            encrypt_in_degree(ctxts[i], values[i], *secret_key);
+        }
+        auto end = Clock::now();
+        for (long i = 0; i < TRIALS; i++)
+            encrypt_in_degree(seeded[i], values[i], *secret_key, noise_var);
+        auto end2 = Clock::now();
+        PRINTF("%ld ctxts encrypt: full %f ms seeded %f ms\n", TRIALS,
+               time_as_millsecond(end - start), time_as_millsecond(end2 - end));
+
+        std::stringstream full, compressed;
+        for (long i = 0; i < TRIALS; i++) {
+            wire::send_ctxt(full, ctxts[i]);
+            wire::send_seeded_ctxt(compressed, seeded[i]);
+        }
+        PRINTF("%ld ctxts bytes: full %zd seeded %zd\n", TRIALS,
+               full.str().size(), compressed.str().size());
+        EXPECT_LT(compressed.str().size() * 3, full.str().size() * 2);
+
+        std::vector<Ctxt> received(TRIALS, *evk);
+        start = Clock::now();
+        for (long i = 0; i < TRIALS; i++)
+            ASSERT_TRUE(wire::receive_seeded_ctxt(compressed, received[i]));
+        end = Clock::now();
+        PRINTF("%ld ctxts expand: %f ms\n", TRIALS, time_as_millsecond(end - start));
+
+        /// The expanded ciphertexts work as the fresh ones in the comparisons.
+        auto gt_args = create_greater_than_args(1L, 0L, *context);
+        NTL::ZZX poly;
+        for (long i = 0; i < TRIALS; i++) {
+            ASSERT_TRUE(received[i].isCorrect());
+            secret_key->Decrypt(poly, received[i]);
+            EXPECT_EQ(1L, NTL::to_long(NTL::coeff(poly, values[i])));
+            const long b = NTL::RandomBnd(phiM);
+            Ctxt result = greater_than(received[i], b, gt_args, *context);
+            secret_key->Decrypt(poly, result);
+            EXPECT_EQ(NTL::coeff(poly, 0) == gt_args.gt(), values[i] > b);
+        }
+    }
+
+    TEST_F(WireFormatBenchmark, RejectWrongFrame) {
+        std::stringstream binary;
+        wire::send_count(binary, 42);
+        Ctxt ctx(*secret_key);
+        EXPECT_FALSE(wire::receive_ctxt(binary, ctx));
+    }
+}